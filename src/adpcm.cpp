@@ -0,0 +1,82 @@
+#include "adpcm.h"
+
+static const int16_t stepTable[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static const int8_t indexTable[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Apply one 4-bit code to the predictor state (shared by encode and decode
+// so the encoder tracks exactly what the decoder will reconstruct)
+static inline int16_t adpcmStep(uint8_t code, int& predictor, int& index) {
+  int step = stepTable[index];
+  int diff = step >> 3;
+  if (code & 4) diff += step;
+  if (code & 2) diff += step >> 1;
+  if (code & 1) diff += step >> 2;
+  predictor += (code & 8) ? -diff : diff;
+  predictor = constrain(predictor, -32768, 32767);
+  index = constrain(index + indexTable[code], 0, 88);
+  return (int16_t)predictor;
+}
+
+size_t adpcmEncodedBytes(int samples) {
+  int blocks = (samples + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES;
+  return (size_t)blocks * ADPCM_BLOCK_BYTES;
+}
+
+void adpcmEncodeBlock(const int16_t* in, int count, uint8_t* out) {
+  int predictor = count > 0 ? in[0] : 0;
+  int index = 0;
+
+  // Start the step size near the block's first sample-to-sample delta
+  if (count > 1) {
+    int delta = abs(in[1] - in[0]);
+    while (index < 88 && stepTable[index] < delta) index++;
+  }
+
+  out[0] = predictor & 0xFF;
+  out[1] = (predictor >> 8) & 0xFF;
+  out[2] = index;
+  out[3] = 0;
+
+  uint8_t* codes = out + 4;
+  memset(codes, 0, ADPCM_BLOCK_SAMPLES / 2);
+  for (int i = 0; i < count; i++) {
+    int diff = in[i] - predictor;
+    int step = stepTable[index];
+    uint8_t code = 0;
+    if (diff < 0) {
+      code = 8;
+      diff = -diff;
+    }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 1; }
+
+    adpcmStep(code, predictor, index);
+    codes[i >> 1] |= (i & 1) ? (code << 4) : code;
+  }
+}
+
+void adpcmDecodeBlock(const uint8_t* in, int count, int16_t* out) {
+  int predictor = (int16_t)(in[0] | (in[1] << 8));
+  int index = constrain(in[2], 0, 88);
+
+  const uint8_t* codes = in + 4;
+  for (int i = 0; i < count; i++) {
+    uint8_t code = (i & 1) ? (codes[i >> 1] >> 4) : (codes[i >> 1] & 0x0F);
+    out[i] = adpcmStep(code, predictor, index);
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <Arduino.h>
+
+// IMA-ADPCM, 4 bits per sample, in independent blocks so any block can be
+// decoded on its own. Block layout: int16 predictor, uint8 step index,
+// uint8 padding, then one nibble per sample (low nibble first).
+#define ADPCM_BLOCK_SAMPLES 256
+#define ADPCM_BLOCK_BYTES (4 + ADPCM_BLOCK_SAMPLES / 2)
+
+size_t adpcmEncodedBytes(int samples);
+void adpcmEncodeBlock(const int16_t* in, int count, uint8_t* out);
+void adpcmDecodeBlock(const uint8_t* in, int count, int16_t* out);
+
+#endif // ADPCM_H
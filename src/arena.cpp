@@ -0,0 +1,179 @@
+#include "arena.h"
+#include "config.h"
+#include <esp_heap_caps.h>
+
+// One entry per used or free region, sorted by offset, always covering the
+// whole arena with no gaps. Adjacent free regions are always merged.
+struct ArenaExtent {
+  uint32_t offset;
+  uint32_t size;
+  bool used;
+};
+
+static uint8_t* arenaBase = nullptr;
+static size_t arenaBytes = 0;
+static ArenaExtent* extents = nullptr;
+static int extentCount = 0;
+
+// loop() and the compression task both allocate
+static SemaphoreHandle_t arenaMutex = nullptr;
+
+static size_t alignUp(size_t bytes) {
+  return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void insertExtent(int index, const ArenaExtent& e) {
+  memmove(&extents[index + 1], &extents[index], (extentCount - index) * sizeof(ArenaExtent));
+  extents[index] = e;
+  extentCount++;
+}
+
+static void removeExtent(int index) {
+  memmove(&extents[index], &extents[index + 1], (extentCount - index - 1) * sizeof(ArenaExtent));
+  extentCount--;
+}
+
+// Merge extents[index] with free neighbours (extents[index] must be free)
+static void coalesce(int index) {
+  if (index + 1 < extentCount && !extents[index + 1].used) {
+    extents[index].size += extents[index + 1].size;
+    removeExtent(index + 1);
+  }
+  if (index > 0 && !extents[index - 1].used) {
+    extents[index - 1].size += extents[index].size;
+    removeExtent(index);
+  }
+}
+
+static int findExtent(void* ptr) {
+  if (!ptr || !arenaBase) return -1;
+  uint32_t offset = (uint8_t*)ptr - arenaBase;
+  int lo = 0, hi = extentCount - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (extents[mid].offset == offset) return extents[mid].used ? mid : -1;
+    if (extents[mid].offset < offset) lo = mid + 1;
+    else hi = mid - 1;
+  }
+  return -1;
+}
+
+bool initArena(size_t bytes) {
+  bytes &= ~(size_t)(ARENA_ALIGN - 1);
+  extents = (ArenaExtent*)ps_malloc(ARENA_MAX_EXTENTS * sizeof(ArenaExtent));
+  arenaBase = (uint8_t*)ps_malloc(bytes);
+  if (!extents || !arenaBase) {
+    Serial.printf("ERROR: Failed to allocate %d byte arena!\n", bytes);
+    free(extents);
+    free(arenaBase);
+    extents = nullptr;
+    arenaBase = nullptr;
+    return false;
+  }
+  arenaBytes = bytes;
+  extents[0] = { 0, (uint32_t)bytes, false };
+  extentCount = 1;
+  arenaMutex = xSemaphoreCreateMutex();
+  return true;
+}
+
+void* arenaAlloc(size_t bytes) {
+  if (!arenaBase || bytes == 0) return nullptr;
+  size_t need = alignUp(bytes);
+  xSemaphoreTake(arenaMutex, portMAX_DELAY);
+
+  // Best fit keeps the big holes available for full-length recordings
+  int best = -1;
+  for (int i = 0; i < extentCount; i++) {
+    if (!extents[i].used && extents[i].size >= need &&
+        (best < 0 || extents[i].size < extents[best].size)) {
+      best = i;
+    }
+  }
+  if (best < 0) {
+    xSemaphoreGive(arenaMutex);
+    return nullptr;
+  }
+
+  // Split off the remainder (if the table is full, hand out the whole hole)
+  if (extents[best].size > need && extentCount < ARENA_MAX_EXTENTS) {
+    ArenaExtent rest = { extents[best].offset + (uint32_t)need, extents[best].size - (uint32_t)need, false };
+    extents[best].size = need;
+    insertExtent(best + 1, rest);
+  }
+  extents[best].used = true;
+  void* ptr = arenaBase + extents[best].offset;
+  xSemaphoreGive(arenaMutex);
+  return ptr;
+}
+
+void arenaFree(void* ptr) {
+  if (!ptr || !arenaBase) return;
+  xSemaphoreTake(arenaMutex, portMAX_DELAY);
+  int index = findExtent(ptr);
+  if (index >= 0) {
+    extents[index].used = false;
+    coalesce(index);
+  }
+  xSemaphoreGive(arenaMutex);
+}
+
+// Caller holds arenaMutex
+static bool shrinkExtent(void* ptr, size_t newBytes) {
+  int index = findExtent(ptr);
+  if (index < 0) return false;
+  size_t keep = alignUp(max(newBytes, (size_t)1));
+  if (keep >= extents[index].size) return true;
+
+  uint32_t tail = extents[index].size - keep;
+  if (index + 1 < extentCount && !extents[index + 1].used) {
+    // Grow the following hole downwards
+    extents[index + 1].offset -= tail;
+    extents[index + 1].size += tail;
+  } else if (extentCount < ARENA_MAX_EXTENTS) {
+    ArenaExtent rest = { extents[index].offset + (uint32_t)keep, tail, false };
+    insertExtent(index + 1, rest);
+  } else {
+    return false;  // Table full - keep the extent at its old size
+  }
+  extents[index].size = keep;
+  return true;
+}
+
+bool arenaShrink(void* ptr, size_t newBytes) {
+  if (!ptr || !arenaBase) return false;
+  xSemaphoreTake(arenaMutex, portMAX_DELAY);
+  bool ok = shrinkExtent(ptr, newBytes);
+  xSemaphoreGive(arenaMutex);
+  return ok;
+}
+
+size_t arenaSize() {
+  return arenaBytes;
+}
+
+size_t arenaFreeBytes() {
+  if (!arenaBase) return 0;
+  size_t total = 0;
+  xSemaphoreTake(arenaMutex, portMAX_DELAY);
+  for (int i = 0; i < extentCount; i++) {
+    if (!extents[i].used) total += extents[i].size;
+  }
+  xSemaphoreGive(arenaMutex);
+  return total;
+}
+
+size_t arenaLargestFree() {
+  if (!arenaBase) return 0;
+  size_t largest = 0;
+  xSemaphoreTake(arenaMutex, portMAX_DELAY);
+  for (int i = 0; i < extentCount; i++) {
+    if (!extents[i].used && extents[i].size > largest) largest = extents[i].size;
+  }
+  xSemaphoreGive(arenaMutex);
+  return largest;
+}
+
+int arenaExtentCount() {
+  return extentCount;
+}
@@ -0,0 +1,20 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+
+// Variable-length allocator over one large PSRAM block.
+// Extents are tracked in a side table (nothing is stored in the arena
+// itself), so blocks can be trimmed in place without moving any audio.
+bool initArena(size_t bytes);
+void* arenaAlloc(size_t bytes);
+void arenaFree(void* ptr);
+bool arenaShrink(void* ptr, size_t newBytes);
+
+// Statistics
+size_t arenaSize();
+size_t arenaFreeBytes();
+size_t arenaLargestFree();
+int arenaExtentCount();
+
+#endif // ARENA_H
@@ -0,0 +1,248 @@
+#include "ax25.h"
+
+// X.25 FCS: CRC-16/CCITT reflected, from 0xFFFF, inverted; sent low byte first
+static uint16_t ax25Fcs(const uint8_t* data, int count) {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < count; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+  }
+  return crc ^ 0xFFFF;
+}
+
+// "CALL-SSID" as an address field: six characters shifted up a bit, space
+// padded, then the SSID byte. Returns the end of the callsign, or nullptr.
+static const char* ax25PutAddress(uint8_t* out, const char* call, uint8_t flags) {
+  int n = 0;
+  while (*call && *call != '-' && *call != ',') {
+    if (n >= 6 || !isalnum((unsigned char)*call)) return nullptr;
+    out[n++] = toupper((unsigned char)*call++) << 1;
+  }
+  if (n == 0) return nullptr;
+  while (n < 6) out[n++] = ' ' << 1;
+  int ssid = 0;
+  if (*call == '-') {
+    ssid = atoi(++call);
+    while (isdigit((unsigned char)*call)) call++;
+    if (ssid > 15) return nullptr;
+  }
+  out[6] = flags | (ssid << 1);
+  return call;
+}
+
+int ax25BuildUi(uint8_t* frame, const char* dest, const char* source, const char* path, const char* info) {
+  int infoLength = strlen(info);
+  int length = 0;
+  if (!ax25PutAddress(frame, dest, 0xE0)) return 0;          // Command: C bit set here
+  if (!ax25PutAddress(frame + 7, source, 0x60)) return 0;
+  length = 14;
+  for (int digis = 0; path && *path; digis++) {
+    if (digis >= AX25_MAX_PATH) return 0;
+    path = ax25PutAddress(frame + length, path, 0x60);
+    if (!path) return 0;
+    length += 7;
+    if (*path == ',') path++;
+  }
+  frame[length - 1] |= 1;  // Last address
+  if (length + 2 + infoLength + 2 > AX25_MAX_FRAME) return 0;
+  frame[length++] = 0x03;  // UI
+  frame[length++] = 0xF0;  // No layer 3
+  memcpy(frame + length, info, infoLength);
+  length += infoLength;
+  uint16_t fcs = ax25Fcs(frame, length);
+  frame[length++] = fcs & 0xFF;
+  frame[length++] = fcs >> 8;
+  return length;
+}
+
+// One address back into "CALL-SSID" (no SSID if it is 0)
+static int ax25GetAddress(const uint8_t* in, char* text) {
+  int n = 0;
+  for (int i = 0; i < 6; i++) {
+    char c = in[i] >> 1;
+    if (c != ' ') text[n++] = c;
+  }
+  int ssid = (in[6] >> 1) & 0x0F;
+  if (ssid) n += sprintf(text + n, "-%d", ssid);
+  text[n] = 0;
+  return n;
+}
+
+bool ax25Format(const uint8_t* frame, int length, char* text, int maxText) {
+  // Find the end of the address field first
+  int addresses = 0;
+  while (addresses * 7 + 7 <= length - 2) {
+    if (frame[addresses++ * 7 + 6] & 1) break;
+  }
+  int body = addresses * 7;
+  if (addresses < 2 || addresses > 2 + AX25_MAX_PATH || !(frame[body - 1] & 1) || body + 2 > length - 2) return false;
+
+  char call[10];
+  String line;
+  ax25GetAddress(frame + 7, call);
+  line += call;
+  line += '>';
+  ax25GetAddress(frame, call);
+  line += call;
+  for (int i = 2; i < addresses; i++) {
+    ax25GetAddress(frame + i * 7, call);
+    line += ',';
+    line += call;
+    if (frame[i * 7 + 6] & 0x80) line += '*';  // Has been repeated
+  }
+  line += ':';
+  if (frame[body] != 0x03 || frame[body + 1] != 0xF0) {
+    char control[24];
+    snprintf(control, sizeof(control), "<control %02X, PID %02X>", frame[body], frame[body + 1]);
+    line += control;
+  } else {
+    for (int i = body + 2; i < length - 2; i++) {
+      line += (frame[i] >= 0x20 && frame[i] < 0x7F) ? (char)frame[i] : '.';
+    }
+  }
+  snprintf(text, maxText, "%s", line.c_str());
+  return true;
+}
+
+// ==================== AFSK Encoder ====================
+
+void afskBegin(AfskEncoder& enc, const uint8_t* frame, int length, int leadFlags, int tailFlags, int16_t amplitude, float sampleRate) {
+  fskModulatorInit(enc.mod, AFSK_MARK_HZ, AFSK_SPACE_HZ, AFSK_BAUD, sampleRate, amplitude);
+  enc.frame = frame;
+  enc.length = length;
+  enc.leadFlags = leadFlags;
+  enc.tailFlags = tailFlags;
+  enc.pos = 0;
+  enc.bit = 0;
+  enc.ones = 0;
+  enc.tone = 0;
+}
+
+// Next bit on the air (before NRZI), or -1 once everything is out
+static int afskNextBit(AfskEncoder& enc) {
+  if (enc.ones == 5) {
+    enc.ones = 0;
+    return 0;  // Stuffed; flags never count, so never inside one
+  }
+  if (enc.pos >= enc.leadFlags + enc.length + enc.tailFlags) return -1;
+
+  int index = enc.pos - enc.leadFlags;
+  bool flag = index < 0 || index >= enc.length;
+  uint8_t byte = flag ? AX25_FLAG : enc.frame[index];
+  int bit = (byte >> enc.bit) & 1;
+  if (++enc.bit == 8) {
+    enc.bit = 0;
+    enc.pos++;
+  }
+  enc.ones = (bit && !flag) ? enc.ones + 1 : 0;
+  return bit;
+}
+
+int afskRender(AfskEncoder& enc, int16_t* out, int maxSamples) {
+  int count = 0;
+  while (count + FSK_MAX_BIT_SAMPLES <= maxSamples) {
+    int bit = afskNextBit(enc);
+    if (bit < 0) break;
+    if (bit == 0) enc.tone ^= 1;
+    count += fskModulateBit(enc.mod, enc.tone, out + count);
+  }
+  return count;
+}
+
+// ==================== Decoder ====================
+
+void ax25Init(Ax25Decoder& dec, float sampleRate) {
+  fskInit(dec.fsk, AFSK_MARK_HZ, AFSK_SPACE_HZ, AFSK_BAUD, sampleRate);
+  ax25Reset(dec);
+}
+
+static void ax25Hunt(Ax25Lane& lane) {
+  lane.length = -1;
+  lane.ones = 0;
+}
+
+void ax25Reset(Ax25Decoder& dec) {
+  fskReset(dec.fsk);
+  for (int p = 0; p < FSK_PHASES; p++) {
+    dec.lanes[p].level = false;
+    ax25Hunt(dec.lanes[p]);
+  }
+  dec.frames = 0;
+  dec.lastLength = 0;
+}
+
+// A flag: a frame ends here (if one was being read) and the next one
+// starts. Returns the length of the frame it closed if that was valid.
+static int ax25LaneFlag(Ax25Lane& lane) {
+  // The flag's first seven bits went in as data; they fill a byte exactly
+  // if the frame was a whole number of bytes
+  bool valid = lane.length >= AX25_MIN_FRAME && lane.bitCount == 7 &&
+               ax25Fcs(lane.frame, lane.length - 2) == (lane.frame[lane.length - 2] | (lane.frame[lane.length - 1] << 8));
+  int length = valid ? lane.length : 0;
+  lane.length = 0;
+  lane.bitCount = 0;
+  lane.ones = 0;
+  return length;
+}
+
+static void ax25LanePush(Ax25Lane& lane, int bit) {
+  if (lane.length < 0) return;
+  lane.byte = (lane.byte >> 1) | (bit << 7);
+  if (++lane.bitCount < 8) return;
+  lane.bitCount = 0;
+  if (lane.length >= AX25_MAX_FRAME) {
+    ax25Hunt(lane);
+    return;
+  }
+  lane.frame[lane.length++] = lane.byte;
+}
+
+// One tone (1 = space) on one lane; the length of the valid frame it closed, or 0
+static int ax25LaneBit(Ax25Lane& lane, int tone) {
+  int bit = tone == lane.level;
+  lane.level = tone;
+
+  if (bit) {
+    if (++lane.ones >= 7) {
+      lane.length = -1;  // Abort, or idle: wait for a flag
+      lane.ones = 7;
+      return 0;
+    }
+    ax25LanePush(lane, 1);
+    return 0;
+  }
+  if (lane.ones == 6) return ax25LaneFlag(lane);
+  bool stuffed = lane.ones == 5;
+  lane.ones = 0;
+  if (!stuffed) ax25LanePush(lane, 0);
+  return 0;
+}
+
+// Feed audio at the rate given to ax25Init
+bool ax25Process(Ax25Decoder& dec, const int16_t* samples, int count) {
+  bool decoded = false;
+  while (count > 0) {
+    int n = min(count, 64);
+    uint8_t bits[64 * FSK_PHASES / 8 + FSK_PHASES];
+    int found = fskDemodulate(dec.fsk, samples, n, bits, sizeof(bits));
+    for (int i = 0; i < found; i++) {
+      Ax25Lane& lane = dec.lanes[bits[i] / 2];
+      int length = ax25LaneBit(lane, bits[i] & 1);
+      if (length == 0) continue;
+      memcpy(dec.last, lane.frame, length);
+      dec.lastLength = length;
+      dec.frames++;
+      decoded = true;
+      // The neighbouring lanes are reading the same frame: only this one
+      // carries on, in case the closing flag also opens the next frame
+      for (int p = 0; p < FSK_PHASES; p++) {
+        if (&dec.lanes[p] != &lane) ax25Hunt(dec.lanes[p]);
+      }
+    }
+    samples += n;
+    count -= n;
+  }
+  return decoded;
+}
@@ -0,0 +1,60 @@
+#ifndef AX25_H
+#define AX25_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fsk.h"
+
+// AX.25 UI frames over Bell 202 AFSK (1200 baud, 1200/2200Hz), as APRS
+// uses them. On the air: flags (0x7E), then the frame bit-stuffed (a 0
+// after every five 1s) and LSB first, then more flags. NRZI: a 0 bit
+// switches tone, a 1 bit keeps it. Frames end in a CRC-16 (X.25 FCS);
+// only frames whose FCS checks out are reported.
+
+#define AX25_MAX_FRAME 330       // 10 addresses, control, PID, 256 info bytes, FCS
+#define AX25_MIN_FRAME 18        // Destination, source, control, PID, FCS
+#define AX25_MAX_PATH 8          // Digipeaters
+#define AX25_FLAG 0x7E
+
+int ax25BuildUi(uint8_t* frame, const char* dest, const char* source, const char* path, const char* info);  // Returns length (FCS included), 0 if it does not fit
+bool ax25Format(const uint8_t* frame, int length, char* text, int maxText);  // TNC2 monitor format: SRC>DST,DIGI*:info
+
+// Streams one frame as audio, a bit at a time
+struct AfskEncoder {
+  FskModulator mod;
+  const uint8_t* frame;
+  int length;
+  int leadFlags;
+  int tailFlags;
+  int pos;            // Byte being sent, counting the lead flags
+  int bit;            // Next bit of it
+  int ones;           // 1s sent in a row (a 0 gets stuffed after five)
+  int tone;           // NRZI state
+};
+
+void afskBegin(AfskEncoder& enc, const uint8_t* frame, int length, int leadFlags, int tailFlags, int16_t amplitude, float sampleRate);
+int afskRender(AfskEncoder& enc, int16_t* out, int maxSamples);  // Returns samples written, 0 once the tail flags are out
+
+// One per FSK bit clock
+struct Ax25Lane {
+  bool level;         // NRZI state
+  int ones;           // 1s received in a row
+  uint8_t byte;
+  int bitCount;       // Bits of byte filled
+  int length;         // Bytes of frame filled, -1 = hunting for a flag
+  uint8_t frame[AX25_MAX_FRAME];
+};
+
+struct Ax25Decoder {
+  FskDemod fsk;
+  Ax25Lane lanes[FSK_PHASES];
+  int frames;         // Valid frames decoded since the reset
+  uint8_t last[AX25_MAX_FRAME];
+  int lastLength;
+};
+
+void ax25Init(Ax25Decoder& dec, float sampleRate);
+void ax25Reset(Ax25Decoder& dec);
+bool ax25Process(Ax25Decoder& dec, const int16_t* samples, int count);  // True if a frame was decoded
+
+#endif // AX25_H
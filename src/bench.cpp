@@ -0,0 +1,416 @@
+#ifdef PARROT_BENCH
+
+#include "bench.h"
+#include "config.h"
+#include "dsp.h"
+#include "dtmf.h"
+#include "ctcss.h"
+#include "dcs.h"
+#include "mdc.h"
+#include "ax25.h"
+#include <radio_test_audio.h>
+
+#define BENCH_BLOCK 256
+#define BENCH_ITERATIONS 2000
+
+// Copy a stretch of the embedded test audio out of flash so the benchmarks
+// measure the kernels, not flash cache misses
+static void loadBenchAudio(int16_t* dest, int count, int offset) {
+  for (int i = 0; i < count; i++) {
+    dest[i] = pgm_read_word(&radioTestAudio[(offset + i) % RADIO_TEST_SAMPLES]);
+  }
+}
+
+static void printBenchResult(const char* name, uint32_t cycles, int iterations, int samples) {
+  float perBlock = (float)cycles / iterations;
+  Serial.printf("  %-28s %8.0f cycles/block  %6.2f cycles/sample\n", name, perBlock, perBlock / samples);
+}
+
+// ==================== Block Statistics ====================
+
+// The per-sample metering loop recordAudioSamples() used to run
+static void legacyMeter(const int16_t* samples, int count, float& peakLevel, int& clips) {
+  for (int i = 0; i < count; i++) {
+    int16_t sample = samples[i];
+    float level = abs(sample) / 32768.0;
+    if (level > peakLevel) peakLevel = level;
+    if (abs(sample) > CLIP_THRESHOLD) clips++;
+  }
+}
+
+static void benchBlockStats() {
+  static int16_t block[BENCH_BLOCK];
+  loadBenchAudio(block, BENCH_BLOCK, RADIO_TEST_SAMPLES / 2);
+
+  float peakLevel = 0;
+  int clips = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    legacyMeter(block, BENCH_BLOCK, peakLevel, clips);
+  }
+  uint32_t legacyCycles = ESP.getCycleCount() - start;
+
+  BlockLevel level;
+  uint32_t peakSum = 0;
+  start = ESP.getCycleCount();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    blockLevel(block, BENCH_BLOCK, level);
+    peakSum += level.peak;  // Keep the optimizer honest
+  }
+  uint32_t kernelCycles = ESP.getCycleCount() - start;
+
+  Serial.println("Block statistics (256 samples):");
+  printBenchResult("float per-sample meter", legacyCycles, BENCH_ITERATIONS, BENCH_BLOCK);
+  printBenchResult("integer blockLevel()", kernelCycles, BENCH_ITERATIONS, BENCH_BLOCK);
+  Serial.printf("  peak %.3f / %d, rms %d, dc %d, clips %d (%u)\n",
+                peakLevel, level.peak, level.rms, level.dc, level.clips, peakSum);
+}
+
+// ==================== Goertzel Bank ====================
+
+// The eight float passes detectDTMF() used to make
+static float legacyGoertzel(const int16_t* samples, int count, float coeff) {
+  float s0 = 0, s1 = 0, s2 = 0;
+  for (int i = 0; i < count; i++) {
+    s0 = samples[i] + coeff * s1 - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+static void benchGoertzel() {
+  static int16_t block[DTMF_BLOCK_SIZE];
+  float coeff[8];
+  for (int t = 0; t < 8; t++) {
+    coeff[t] = 2.0f * cosf(2.0f * PI * DtmfTones<SAMPLE_RATE>::hz(t) / SAMPLE_RATE);
+  }
+
+  // A '5' (770 + 1336Hz) over the test audio, so every filter has work to do
+  loadBenchAudio(block, DTMF_BLOCK_SIZE, RADIO_TEST_SAMPLES / 3);
+  for (int i = 0; i < DTMF_BLOCK_SIZE; i++) {
+    block[i] = block[i] / 2 + (int16_t)(6000 * (sinf(2 * PI * 770 * i / SAMPLE_RATE) + sinf(2 * PI * 1336 * i / SAMPLE_RATE)));
+  }
+
+  float legacy[8];
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    for (int t = 0; t < 8; t++) {
+      legacy[t] = legacyGoertzel(block, DTMF_BLOCK_SIZE, coeff[t]);
+    }
+  }
+  uint32_t legacyCycles = ESP.getCycleCount() - start;
+
+  int64_t power[8];
+  start = ESP.getCycleCount();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    DtmfTones<SAMPLE_RATE>::process(block, DTMF_BLOCK_SIZE, power);
+  }
+  uint32_t bankCycles = ESP.getCycleCount() - start;
+
+  float worst = 0;
+  for (int t = 0; t < 8; t++) {
+    float err = fabsf((float)power[t] - legacy[t]) / max(legacy[t], 1.0f);
+    if (err > worst) worst = err;
+  }
+
+  Serial.printf("DTMF Goertzel, 8 tones (%d samples):\n", DTMF_BLOCK_SIZE);
+  printBenchResult("8 float passes", legacyCycles, BENCH_ITERATIONS, DTMF_BLOCK_SIZE);
+  printBenchResult("ToneBank<> Q30", bankCycles, BENCH_ITERATIONS, DTMF_BLOCK_SIZE);
+  Serial.printf("  worst power difference %.4f%%, 770Hz %.3g, 1336Hz %.3g, 941Hz %.3g\n",
+                100.0f * worst, (float)power[1], (float)power[5], (float)power[3]);
+}
+
+// ==================== DTMF Detector ====================
+// Both detector paths over the test recording, for the cost per sample on
+// the target. Accuracy and latency are checked on the host (test_dtmf).
+
+static void benchDtmfPath(const char* name, bool lowRate) {
+  static DtmfDetector det;
+  static int16_t block[BENCH_BLOCK];
+  dtmfInit(det, lowRate ? DTMF_LOW_RATE_BLOCK_SIZE : DTMF_BLOCK_SIZE, lowRate);
+
+  uint32_t cycles = 0;
+  int found = 0;
+  for (int offset = 0; offset + BENCH_BLOCK <= RADIO_TEST_SAMPLES; offset += BENCH_BLOCK) {
+    loadBenchAudio(block, BENCH_BLOCK, offset);
+    DtmfDigit digits[4];
+    uint32_t start = ESP.getCycleCount();
+    found += dtmfProcess(det, block, BENCH_BLOCK, digits, 4);
+    cycles += ESP.getCycleCount() - start;
+  }
+
+  int samples = RADIO_TEST_SAMPLES / BENCH_BLOCK * BENCH_BLOCK;
+  float hz = ESP.getCpuFreqMHz() * 1e6f;
+  Serial.printf("  %-13s %6.2f cycles/sample, %5.2f Msamples/s (%.2f%% of a core in real time), %d digits\n",
+                name, (float)cycles / samples, hz * samples / cycles / 1e6f, 100.0f * SAMPLE_RATE * cycles / samples / hz, found);
+}
+
+static void benchDtmf() {
+  Serial.println("DTMF detector (test audio):");
+  benchDtmfPath("22050Hz path:", false);
+  benchDtmfPath("7350Hz path:", true);
+}
+
+// ==================== Sub-audible Decoders ====================
+// Two seconds of a CTCSS tone (at about -40dBFS, a typical deviation under
+// voice) or a DCS code over the test audio, through the same CIC as
+// recordSamples(). The speech goes through an 8th-order 300Hz high-pass
+// first, as it would in the transmitting radio - the raw file has plenty
+// of energy in the sub-audible band.
+
+struct SubaudibleCase {
+  float toneHz;    // 0 = no tone
+  uint16_t dcs;    // Octal code, 0 = none
+  bool inverted;
+};
+
+static const SubaudibleCase SUBAUDIBLE_CASES[] = {
+  {67.0f, 0, false}, {100.0f, 0, false}, {162.2f, 0, false}, {254.1f, 0, false},
+  {0, 0023, false}, {0, 0411, false}, {0, 0754, true}, {0, 0, false}
+};
+
+static void loadSubaudible(const SubaudibleCase& c, int16_t* block, int offset, Biquad* voiceFilter, Biquad& dcsFilter) {
+  static int16_t code[BENCH_BLOCK];
+  loadBenchAudio(block, BENCH_BLOCK, offset);
+  biquadProcess(voiceFilter, 4, block, BENCH_BLOCK);
+
+  // DCS: NRZ at +/-400, shaped by a 300Hz low-pass like the transmitter's
+  uint32_t word = c.dcs ? dcsCodeword(c.dcs) : 0;
+  for (int i = 0; i < BENCH_BLOCK; i++) {
+    int bit = (int)((offset + i) * DCS_BIT_RATE / SAMPLE_RATE) % 23;
+    bool one = ((word >> bit) & 1) != c.inverted;
+    code[i] = c.dcs ? (one ? 400 : -400) : 0;
+  }
+  biquadProcess(&dcsFilter, 1, code, BENCH_BLOCK);
+
+  for (int i = 0; i < BENCH_BLOCK; i++) {
+    int tone = c.toneHz > 0 ? (int)(300 * sinf(2 * PI * c.toneHz * (offset + i) / SAMPLE_RATE)) : 0;
+    block[i] = constrain(block[i] + tone + code[i], -32768, 32767);
+  }
+}
+
+static void benchSubaudible() {
+  static CicDecimator cic;
+  static CtcssDecoder ctcss;
+  static DcsDecoder dcs;
+  static int16_t block[BENCH_BLOCK];
+  static const float voiceQ[4] = {0.5098f, 0.6013f, 0.9000f, 2.5629f};
+  Biquad voiceFilter[4];
+  Biquad dcsFilter;
+  ctcssReset(ctcss);
+  dcsInit(dcs, SUBAUDIBLE_RATE);
+
+  Serial.println("CTCSS / DCS decoders (2s over the test audio):");
+  uint32_t cicCycles = 0, ctcssCycles = 0, dcsCycles = 0;
+  int samples = 0;
+  int cases = sizeof(SUBAUDIBLE_CASES) / sizeof(SUBAUDIBLE_CASES[0]);
+  for (int t = 0; t < cases; t++) {
+    const SubaudibleCase& c = SUBAUDIBLE_CASES[t];
+    cicReset(cic, SUBAUDIBLE_DECIMATION);
+    ctcssReset(ctcss);
+    dcsReset(dcs);
+    for (int k = 0; k < 4; k++) biquadHighpass(voiceFilter[k], 300, voiceQ[k]);
+    biquadLowpass(dcsFilter, DCS_LOWPASS_HZ, 0.7071f, SAMPLE_RATE);
+
+    for (int offset = 0; offset < 2 * SAMPLE_RATE; offset += BENCH_BLOCK) {
+      loadSubaudible(c, block, offset, voiceFilter, dcsFilter);
+      int16_t low[BENCH_BLOCK / SUBAUDIBLE_DECIMATION + 1];
+      uint32_t start = ESP.getCycleCount();
+      int count = cicDecimate(cic, block, BENCH_BLOCK, low);
+      uint32_t mid = ESP.getCycleCount();
+      ctcssProcess(ctcss, low, count);
+      uint32_t end = ESP.getCycleCount();
+      dcsProcess(dcs, low, count);
+      dcsCycles += ESP.getCycleCount() - end;
+      ctcssCycles += end - mid;
+      cicCycles += mid - start;
+      samples += BENCH_BLOCK;
+    }
+
+    int tone = ctcssResult(ctcss);
+    int code = dcsResult(dcs);
+    char sent[5], heard[5], twin[5];
+    snprintf(sent, sizeof(sent), c.dcs ? "%03o%c" : "", c.dcs, c.inverted ? 'I' : 'N');
+    dcsCodeName(code, heard);
+    dcsCodeName(dcsTwin(dcs, code), twin);
+    float heardHz = tone >= 0 ? CTCSS_TONE_TABLE[tone].hz : 0;
+    bool ok = heardHz == c.toneHz && (strcmp(sent, heard) == 0 || strcmp(sent, twin) == 0);
+    Serial.printf("  sent %5.1f Hz %-4s  heard %5.1f Hz %-4s = %-4s  %s\n", c.toneHz, sent, heardHz, heard, twin, ok ? "ok" : "WRONG");
+  }
+  float seconds = (float)samples / SAMPLE_RATE;
+  Serial.printf("  CIC to %d Hz: %8.0f cycles per second of audio\n", SUBAUDIBLE_RATE, cicCycles / seconds);
+  Serial.printf("  CTCSS:       %8.0f cycles per second of audio\n", ctcssCycles / seconds);
+  Serial.printf("  DCS:         %8.0f cycles per second of audio\n", dcsCycles / seconds);
+}
+
+// ==================== MDC1200 ====================
+// One clean PTT ID burst through the decoder, for its cost on the target.
+// Decoding under noise, speech, clock offset and bit errors is checked on
+// the host (test_mdc).
+
+#define MDC_BENCH_LEVEL 6000
+
+static void benchMdc() {
+  static MdcDecoder mdc;
+  static uint8_t bits[MDC_BURST_BITS];
+  int16_t samples[FSK_MAX_BIT_SAMPLES];
+  mdcInit(mdc, SAMPLE_RATE);
+  MdcFrame frame = {0x01, 0x80, 0x1234};  // PTT ID, post
+  int bitCount = mdcEncode(frame, bits);
+
+  // NRZI: the high tone when the bit differs from the one before
+  FskModulator mod;
+  fskModulatorInit(mod, MDC_TONE_LOW_HZ, MDC_TONE_HIGH_HZ, MDC_BAUD, SAMPLE_RATE, MDC_BENCH_LEVEL);
+  uint32_t cycles = 0;
+  int total = 0;
+  for (int bit = 0; bit < bitCount; bit++) {
+    int n = fskModulateBit(mod, bits[bit] != (bit > 0 ? bits[bit - 1] : 0), samples);
+    uint32_t start = ESP.getCycleCount();
+    mdcProcess(mdc, samples, n);
+    cycles += ESP.getCycleCount() - start;
+    total += n;
+  }
+
+  Serial.printf("MDC1200 decoder (one %d ms burst):\n", total * 1000 / SAMPLE_RATE);
+  Serial.printf("  %8.0f cycles per second of audio, %.2f cycles/sample\n",
+                (float)cycles * SAMPLE_RATE / total, (float)cycles / total);
+  if (mdc.frames > 0) {
+    Serial.printf("  heard unit %04X\n", mdc.last.unit);
+  } else {
+    Serial.println("  heard nothing");
+  }
+}
+
+// ==================== AFSK1200 / AX.25 ====================
+// One telemetry frame through the encoder and straight into the decoder,
+// for the cost of each on the target. The loopback under noise, clock
+// offset and de-emphasis is checked on the host (test_afsk).
+
+#define AFSK_BENCH_LEVEL 6000
+
+static void benchAfsk() {
+  static Ax25Decoder packet;
+  static int16_t block[BENCH_BLOCK];
+  ax25Init(packet, SAMPLE_RATE);
+
+  uint8_t frame[AX25_MAX_FRAME];
+  int length = ax25BuildUi(frame, BEACON_DEST, "N0CALL-7", BEACON_PATH, "T#042,087,041,123,005,017,10100000");
+  AfskEncoder encoder;
+  afskBegin(encoder, frame, length, AFSK_TXDELAY_FLAGS, AFSK_TAIL_FLAGS, AFSK_BENCH_LEVEL, SAMPLE_RATE);
+
+  uint32_t encodeCycles = 0, decodeCycles = 0;
+  int total = 0;
+  for (;;) {
+    uint32_t start = ESP.getCycleCount();
+    int n = afskRender(encoder, block, BENCH_BLOCK);
+    encodeCycles += ESP.getCycleCount() - start;
+    if (n == 0) break;
+    start = ESP.getCycleCount();
+    ax25Process(packet, block, n);
+    decodeCycles += ESP.getCycleCount() - start;
+    total += n;
+  }
+
+  bool match = packet.frames == 1 && packet.lastLength == length && memcmp(packet.last, frame, length) == 0;
+  Serial.printf("AX.25 over AFSK1200 (%d byte frame, %d ms per beacon):\n", length, total * 1000 / SAMPLE_RATE);
+  Serial.printf("  encoder  %8.0f cycles per second of audio, %.2f cycles/sample\n",
+                (float)encodeCycles * SAMPLE_RATE / total, (float)encodeCycles / total);
+  Serial.printf("  decoder  %8.0f cycles per second of audio, %.2f cycles/sample\n",
+                (float)decodeCycles * SAMPLE_RATE / total, (float)decodeCycles / total);
+  Serial.printf("  frame %s\n", match ? "decoded" : "NOT decoded");
+}
+
+// ==================== Tone Oscillator ====================
+
+#define TONE_BENCH_HZ 1000
+#define TONE_BENCH_MAX_ERROR 4     // LSB from a true sine, at full scale
+#define TONE_BENCH_MAX_EDGE 64     // First and last samples, out of 32767
+
+// The per-sample loop playTone() used to run
+static void legacyTone(int16_t* out, int count, int start, int frequency, int amplitude) {
+  for (int i = 0; i < count; i++) {
+    float t = (float)(start + i) / SAMPLE_RATE;
+    out[i] = (int16_t)(amplitude * sin(2 * PI * frequency * t));
+  }
+}
+
+static void benchTones() {
+  static int16_t block[BENCH_BLOCK];
+  int ramp = SAMPLE_RATE * TONE_RAMP_MS / 1000;
+  int length = BENCH_ITERATIONS * BENCH_BLOCK;
+
+  uint32_t legacyCycles = 0;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    uint32_t start = ESP.getCycleCount();
+    legacyTone(block, BENCH_BLOCK, i * BENCH_BLOCK, TONE_BENCH_HZ, 32767);
+    legacyCycles += ESP.getCycleCount() - start;
+  }
+
+  // Against a true sine at the oscillator's own (32-bit phase step)
+  // frequency, between the attack and the release
+  ToneOsc osc;
+  toneStart(osc, TONE_BENCH_HZ, 32767, length, ramp, SAMPLE_RATE);
+  double step = (double)osc.step / 4294967296.0;
+  uint32_t oscCycles = 0;
+  int maxError = 0;
+  int edge = 0;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    uint32_t start = ESP.getCycleCount();
+    toneRender(osc, block, BENCH_BLOCK);
+    oscCycles += ESP.getCycleCount() - start;
+    if (i == 0) edge = max(edge, abs(block[0]));
+    if (i == BENCH_ITERATIONS - 1) edge = max(edge, abs(block[BENCH_BLOCK - 1]));
+    if (i == 0 || i == BENCH_ITERATIONS - 1) continue;
+    for (int k = 0; k < BENCH_BLOCK; k++) {
+      double cycles = step * ((double)i * BENCH_BLOCK + k);
+      int expected = (int)lround(32767.0 * sin(2 * M_PI * (cycles - floor(cycles))));
+      maxError = max(maxError, abs(block[k] - expected));
+    }
+  }
+
+  Serial.printf("Tone oscillator (%d Hz, 256 samples):\n", TONE_BENCH_HZ);
+  printBenchResult("legacy float sin()", legacyCycles, BENCH_ITERATIONS, BENCH_BLOCK);
+  printBenchResult("toneRender()", oscCycles, BENCH_ITERATIONS, BENCH_BLOCK);
+  Serial.printf("  worst error %d LSB, edges %d (with a %d-sample ramp)\n", maxError, edge, ramp);
+  Serial.printf("  Tones: %s\n", maxError <= TONE_BENCH_MAX_ERROR && edge <= TONE_BENCH_MAX_EDGE ? "PASS" : "FAIL");
+}
+
+// ==================== Capture Filters ====================
+
+static void benchFilters() {
+  static int16_t block[BENCH_BLOCK];
+  Biquad stages[BIQUAD_MAX_STAGES];
+  biquadDcBlocker(stages[0], FILTER_DC_POLE);
+  biquadHighpass(stages[1], FILTER_HIGHPASS_HZ, 0.5412f);
+  biquadHighpass(stages[2], FILTER_HIGHPASS_HZ, 1.3066f);
+  biquadDeemphasis(stages[3], FILTER_DEEMPHASIS_US, FILTER_DEEMPHASIS_ZERO_HZ);
+
+  uint32_t cycles = 0;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    loadBenchAudio(block, BENCH_BLOCK, i * BENCH_BLOCK);
+    uint32_t start = ESP.getCycleCount();
+    biquadProcess(stages, BIQUAD_MAX_STAGES, block, BENCH_BLOCK);
+    cycles += ESP.getCycleCount() - start;
+  }
+
+  Serial.println("Capture filters (256 samples):");
+  printBenchResult("biquadProcess(), 4 stages", cycles, BENCH_ITERATIONS, BENCH_BLOCK);
+  Serial.printf("  budget %d cycles/block: %s\n", FILTER_CYCLE_BUDGET,
+                cycles / BENCH_ITERATIONS <= FILTER_CYCLE_BUDGET ? "PASS" : "FAIL");
+}
+
+void runBenchmarks() {
+  Serial.printf("==== DSP benchmarks (%d MHz) ====\n", ESP.getCpuFreqMHz());
+  benchBlockStats();
+  benchFilters();
+  benchTones();
+  benchGoertzel();
+  benchDtmf();
+  benchSubaudible();
+  benchMdc();
+  benchAfsk();
+  Serial.println("==== benchmarks done ====");
+}
+
+#endif // PARROT_BENCH
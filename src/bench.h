@@ -0,0 +1,10 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// On-device DSP benchmarks, built only in the esp32_wrover_bench environment
+// (-DPARROT_BENCH). Results go to the serial console at the end of setup().
+#ifdef PARROT_BENCH
+void runBenchmarks();
+#endif
+
+#endif // BENCH_H
@@ -0,0 +1,186 @@
+#include "capture.h"
+#include "config.h"
+#include "radio.h"
+#include <atomic>
+#include <driver/i2s.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#define RING_MASK (CAPTURE_RING_SAMPLES - 1)
+
+// The producer only ever advances ringWrite and the consumer only ever
+// advances ringRead. Both are free-running sample counters (wrap at 2^32),
+// the ring position is the counter masked by RING_MASK.
+static int16_t* ring = nullptr;
+static std::atomic<uint32_t> ringWrite(0);
+static std::atomic<uint32_t> ringRead(0);
+
+CaptureStats captureStats = {};
+
+static TaskHandle_t captureTaskHandle = nullptr;
+
+// Sample clock vs esp_timer: offset = (time of sample N in us) - N * 1e6 / SAMPLE_RATE.
+// i2s_read() returns at or after the moment sample N landed, never before,
+// so every offset is the true one plus scheduling delay: the smallest seen
+// is the best estimate. Kept per window so slow clock drift is followed.
+static portMUX_TYPE timingMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t timingOffsetUs = 0;
+static int64_t windowOffsetUs = INT64_MAX;
+static int windowBlocks = 0;
+static uint64_t samplesCaptured = 0;
+
+static void updateTiming(uint64_t totalSamples, int64_t nowUs) {
+  int64_t offset = nowUs - (int64_t)(totalSamples * 1000000ULL / SAMPLE_RATE);
+  portENTER_CRITICAL(&timingMux);
+  if (offset < windowOffsetUs) windowOffsetUs = offset;
+  if (++windowBlocks >= CAPTURE_TIMING_WINDOW || samplesCaptured == 0) {
+    timingOffsetUs = windowOffsetUs;
+    windowOffsetUs = INT64_MAX;
+    windowBlocks = 0;
+  } else if (windowOffsetUs < timingOffsetUs) {
+    timingOffsetUs = windowOffsetUs;
+  }
+  samplesCaptured = totalSamples;
+  portEXIT_CRITICAL(&timingMux);
+}
+
+// Samples the consumer may still safely read behind the write counter.
+// The producer DMA-copies straight into the block after ringWrite, so that
+// block (plus one more of margin for a preempted reader) is off limits.
+#define RING_SAFE_SAMPLES (CAPTURE_RING_SAMPLES - 2 * CAPTURE_BLOCK_SAMPLES)
+
+static void captureTask(void* param) {
+  for (;;) {
+    uint32_t w = ringWrite.load(std::memory_order_relaxed);
+    uint32_t offset = w & RING_MASK;
+    size_t want = min(CAPTURE_BLOCK_SAMPLES, CAPTURE_RING_SAMPLES - (int)offset);
+    size_t bytesRead = 0;
+
+    // Block until the DMA has a full buffer - no polling, no timeouts
+    esp_err_t err = i2s_read(I2S_PORT, &ring[offset], want * sizeof(int16_t), &bytesRead, portMAX_DELAY);
+    if (err != ESP_OK || bytesRead == 0) {
+      captureStats.readErrors++;
+      vTaskDelay(1);
+      continue;
+    }
+
+    int64_t nowUs = esp_timer_get_time();
+    uint32_t samples = bytesRead / sizeof(int16_t);
+    ringWrite.store(w + samples, std::memory_order_release);
+    captureStats.blocks++;
+
+    // Count lapping here, where it happens, rather than when the consumer
+    // next reads: an overflow when the reader first falls a ring behind,
+    // and every sample after that it will have to skip
+    uint32_t behind = w + samples - ringRead.load(std::memory_order_acquire);
+    if (behind > RING_SAFE_SAMPLES) {
+      uint32_t lost = min(behind - RING_SAFE_SAMPLES, samples);
+      if (lost == behind - RING_SAFE_SAMPLES) captureStats.overflows++;
+      captureStats.droppedSamples += lost;
+    }
+    // Mid-block offset would be nicer, but nowUs is when the *last* sample landed
+    updateTiming(samplesCaptured + samples, nowUs);
+    pollI2SEvents();
+  }
+}
+
+void initCapture() {
+  ring = (int16_t*)heap_caps_malloc(CAPTURE_RING_SAMPLES * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!ring) {
+    ring = (int16_t*)ps_malloc(CAPTURE_RING_SAMPLES * sizeof(int16_t));
+    Serial.println("Warning: capture ring allocated in PSRAM");
+  }
+  if (!ring) {
+    Serial.println("ERROR: Failed to allocate capture ring!");
+    return;
+  }
+  memset(ring, 0, CAPTURE_RING_SAMPLES * sizeof(int16_t));
+
+  xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, NULL,
+                          CAPTURE_TASK_PRIORITY, &captureTaskHandle, CAPTURE_TASK_CORE);
+  Serial.printf("Capture task started on core %d (%d sample ring)\n",
+                CAPTURE_TASK_CORE, CAPTURE_RING_SAMPLES);
+}
+
+// Capture sample counter (same numbering as the ring) for an esp_timer time
+uint32_t captureSampleAt(int64_t timeUs) {
+  portENTER_CRITICAL(&timingMux);
+  int64_t offset = timingOffsetUs;
+  portEXIT_CRITICAL(&timingMux);
+  int64_t sample = (timeUs - offset) * SAMPLE_RATE / 1000000LL;
+  return (uint32_t)sample;
+}
+
+uint32_t capturePosition() {
+  return ringRead.load(std::memory_order_relaxed);
+}
+
+uint32_t captureWritePosition() {
+  return ringWrite.load(std::memory_order_acquire);
+}
+
+// Move the read position to an absolute sample counter, clamped to what
+// the ring still holds. Returns how many samples are now waiting.
+size_t captureSeek(uint32_t sample) {
+  uint32_t w = ringWrite.load(std::memory_order_acquire);
+  int32_t behind = (int32_t)(w - sample);
+  behind = constrain(behind, 0, (int32_t)RING_SAFE_SAMPLES);
+  behind = min(behind, (int32_t)w);
+  ringRead.store(w - behind, std::memory_order_release);
+  return behind;
+}
+
+size_t captureAvailable() {
+  uint32_t backlog = ringWrite.load(std::memory_order_acquire) - ringRead.load(std::memory_order_relaxed);
+  return min(backlog, (uint32_t)RING_SAFE_SAMPLES);
+}
+
+void captureFlush() {
+  ringRead.store(ringWrite.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+size_t captureRead(int16_t* dest, size_t maxSamples) {
+  if (!ring) return 0;
+
+  uint32_t start = ringRead.load(std::memory_order_relaxed);
+  uint32_t w = ringWrite.load(std::memory_order_acquire);
+  uint32_t backlog = w - start;
+  if (backlog > captureStats.maxBacklog) captureStats.maxBacklog = backlog;
+
+  // Fell too far behind - the oldest samples are already overwritten (the
+  // capture task has counted them)
+  if (backlog > RING_SAFE_SAMPLES) {
+    start = w - RING_SAFE_SAMPLES;
+    backlog = RING_SAFE_SAMPLES;
+  }
+
+  size_t count = min((size_t)backlog, maxSamples);
+  if (count == 0) {
+    ringRead.store(start, std::memory_order_release);
+    return 0;
+  }
+
+  uint32_t offset = start & RING_MASK;
+  size_t first = min(count, (size_t)(CAPTURE_RING_SAMPLES - offset));
+  memcpy(dest, &ring[offset], first * sizeof(int16_t));
+  if (count > first) {
+    memcpy(dest + first, &ring[0], (count - first) * sizeof(int16_t));
+  }
+
+  // If the producer lapped us while we were copying, the copy is torn: skip
+  // to where the ring is still good, past the samples it counted as lost
+  uint32_t w2 = ringWrite.load(std::memory_order_acquire);
+  if (w2 - start > CAPTURE_RING_SAMPLES - CAPTURE_BLOCK_SAMPLES) {
+    ringRead.store(w2 - RING_SAFE_SAMPLES, std::memory_order_release);
+    return 0;
+  }
+
+  ringRead.store(start + count, std::memory_order_release);
+  return count;
+}
+
+void printCaptureStats() {
+  Serial.printf("Capture: blocks=%u errors=%u overflows=%u dropped=%u max backlog=%u/%d\n",
+                captureStats.blocks, captureStats.readErrors, captureStats.overflows,
+                captureStats.droppedSamples, captureStats.maxBacklog, CAPTURE_RING_SAMPLES);
+}
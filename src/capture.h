@@ -0,0 +1,33 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Arduino.h>
+
+// Capture statistics (all but maxBacklog written by the capture task, so
+// losses count whether or not anyone is reading at the time; maxBacklog
+// by whoever calls captureRead())
+struct CaptureStats {
+  uint32_t blocks;          // I2S reads completed by the capture task
+  uint32_t readErrors;      // i2s_read() failures
+  uint32_t overflows;       // Times the consumer fell a full ring behind
+  uint32_t droppedSamples;  // Samples overwritten before they were read
+  uint32_t maxBacklog;      // High-water mark of unread samples
+};
+extern CaptureStats captureStats;
+
+// Continuous I2S capture task feeding a single-producer/single-consumer ring
+void initCapture();
+
+// Consumer side (one caller at a time: the record task, or loop() holding it off)
+size_t captureRead(int16_t* dest, size_t maxSamples);
+size_t captureAvailable();
+void captureFlush();
+size_t captureSeek(uint32_t sample);
+uint32_t capturePosition();
+uint32_t captureWritePosition();
+
+// Map an esp_timer timestamp to the capture sample counter
+uint32_t captureSampleAt(int64_t timeUs);
+void printCaptureStats();
+
+#endif // CAPTURE_H
@@ -27,6 +27,7 @@
 #define I2S_SD_OUT 25  // Audio to external device
 
 #define I2S_PORT I2S_NUM_0
+#define I2S_EVENT_QUEUE_LEN 16  // Driver events (two per DMA buffer when playing)
 
 // Battery voltage monitoring (ESP-WROVER-KIT: 100K/100K divider on IO35)
 #define VBAT_PIN 35
@@ -38,21 +39,141 @@
 // ==================== Audio Settings ====================
 
 #define SAMPLE_RATE 22050  // eSpeak NG native rate
-#define MAX_RECORDING_SECONDS 10
-#define MAX_SAMPLES (SAMPLE_RATE * MAX_RECORDING_SECONDS)
+#define MAX_RECORDING_SECONDS 10       // Default recording limit (web-configurable)
+#define MAX_RECORDING_SECONDS_LIMIT 120  // Upper bound for the setting
 
 // Minimum recording thresholds (ignore squelch pops / no-signal)
 #define MIN_RECORDING_SAMPLES (SAMPLE_RATE / 2)  // 0.5 seconds
 #define MIN_AUDIO_LEVEL 0.02f                     // Peak level below this = no signal
 
+// Voice-activity trimming of leading carrier and trailing squelch tail
+#define VAD_MIN_RMS 300                    // ~-40dBFS, quieter blocks are never speech
+#define VAD_SNR_RATIO 4                    // Block energy vs quietest block (6dB)
+#define VAD_MAX_FLATNESS 50                // Percent; noisier blocks are squelch hiss
+#define VAD_MIN_SPEECH_BLOCKS 8            // ~90ms of speech before trimming at all
+#define VAD_LEAD_MARGIN (SAMPLE_RATE / 7)  // ~150ms kept before the first speech
+#define VAD_TAIL_MARGIN (SAMPLE_RATE / 4)  // ~250ms kept after the last speech
+
 // Signal quality thresholds
 #define CLIP_THRESHOLD 32112  // 98% of 32768
 #define CLIP_COUNT_WARN 100   // Need this many clipped samples to warn
 
+// Beeps and feedback earcons
+#define TONE_RAMP_MS 5        // Raised-cosine attack and release, so tones never click
+
+// ==================== Capture Task ====================
+
+#define CAPTURE_BLOCK_SAMPLES 256    // One I2S DMA buffer
+#define CAPTURE_RING_SAMPLES 16384   // Power of two, ~740ms at 22050Hz (32KB internal RAM)
+#define CAPTURE_TASK_CORE 0          // Arduino loop() runs on core 1
+#define CAPTURE_TASK_PRIORITY 18     // Above loop() and the web server, below WiFi
+#define CAPTURE_TASK_STACK 3072
+#define CAPTURE_TIMING_WINDOW 64     // Blocks per sample-clock offset estimate (~0.75s)
+#define RECORD_TASK_CORE 1           // Drains the ring into the recorder and decoders
+#define RECORD_TASK_PRIORITY 2       // Above loop(), so getRSSI() and the web server can't hold it up
+#define RECORD_TASK_STACK 6144
+#define RECORD_TASK_PERIOD_MS 20     // Ring holds ~740ms, so this is plenty of margin
+
+// Capture filter chain (Q14 biquads, per block, before metering and storage)
+#define FILTER_DC_POLE 0.995f            // DC blocker, ~18Hz
+#define FILTER_HIGHPASS_HZ 300           // 4th-order Butterworth, takes out CTCSS
+#define FILTER_DEEMPHASIS_US 750         // NFM de-emphasis time constant
+#define FILTER_DEEMPHASIS_ZERO_HZ 3000   // Flattens out above the voice band
+#define FILTER_CYCLE_BUDGET 60000        // Per 256-sample block (~2% of its 11.6ms at 240MHz)
+
+// Squelch (pinAudioOn) edges are timestamped in an ISR and debounced
+#define SQUELCH_DEBOUNCE_US 5000
+
+// Pre-roll: audio from before the squelch opened, stitched onto each recording
+#define PREROLL_MS_DEFAULT 300
+#define PREROLL_MS_MAX 500           // Must stay well inside the capture ring
+
+// ==================== TX Task ====================
+
+#define TX_TASK_CORE 1               // With loop(), which no longer waits on it
+#define TX_TASK_PRIORITY 2           // Above loop() and the web server, so audio never starves
+#define TX_TASK_STACK 8192           // Weather fetches run on it, as they did on loop()'s 8KB
+#define TTS_TASK_CORE 0              // eSpeak runs here while core 1 plays what it made
+#define TTS_TASK_PRIORITY 2          // Above background compression, below capture
+#define TTS_TASK_STACK 8192          // Same as the loop() task eSpeak used to run on
+#define TTS_RING_SAMPLES 32768       // Power of two: speech synthesized ahead, ~1.5s (64KB PSRAM)
+#define TTS_MAX_QUEUED 32            // Utterances queued ahead of playback (at least TX_MAX_STEPS)
+#define TX_QUEUE_LEN 4
+#define TX_MAX_STEPS 16              // A full reply with feedback is up to 14
+#define REPLY_WAIT_MS 2000           // After a recording, before keying up to answer it
+
 // ==================== DTMF Settings ====================
 
-#define MAX_SLOTS 8  // DTMF 1-8 (9 slots won't fit in PSRAM with 10-sec recordings)
-#define DTMF_BLOCK_SIZE 205   // ~9.3ms at 22050Hz, good for Goertzel
+#define MAX_SLOTS 64  // Slot table size; how many are kept depends on recording lengths
+#define DTMF_BLOCK_SIZE 282   // 12.8ms at 22050Hz: 78Hz bins, so neighbouring tones land near nulls
+#define DTMF_MIN_LEVEL 1000               // Each tone's amplitude (~-30dBFS)
+#define DTMF_MIN_TONE_PERCENT 60          // Share of the block's energy in the two tones
+#define DTMF_MAX_TWIST_DB 9.0f            // Column tone weaker than the row tone (8dB + ~1dB block-to-block spread)
+#define DTMF_MAX_REVERSE_TWIST_DB 4.0f    // Row tone weaker than the column tone
+#define DTMF_RELATIVE_PEAK_DB 7.0f        // Over the other tones in its group (the row tone leaks ~15dB down into the column bins)
+#define DTMF_HARMONIC_REJECT_DB 10.0f     // Each tone over its own 2nd harmonic
+#define DTMF_MIN_ON_BLOCKS 2              // ~26ms before a digit counts (40ms tones always make it)
+#define DTMF_STEADY_DB 3.0f               // Level change allowed between those blocks (a part-filled block is weaker)
+#define DTMF_MIN_OFF_BLOCKS 3             // ~38ms gap before the same digit counts again (10ms dropouts don't)
+#define DTMF_MAX_DIGITS 16                // Longest command sequence
+#define DTMF_DIGIT_TIMEOUT_MS 2000        // Gap that ends a sequence without '#'
+// Optional low-rate path: lowpass and decimate to 7350Hz first (DTMF tops
+// out at 1633Hz, its harmonics at 3266Hz) and run the same detector on 1/3
+// of the samples
+#define DTMF_DECIMATION 3
+#define DTMF_LOW_RATE_BLOCK_SIZE 94       // 12.8ms at 7350Hz, the same 78Hz bins
+#define DTMF_LOW_RATE_TAPS 21             // 7 MACs per output sample
+#define DTMF_LOW_RATE_CUTOFF_HZ 3000.0f   // ~60dB down where 5.7-9kHz would alias onto the tones
+#define DTMF_LOW_RATE_KAISER_BETA 5.0f
+
+// ==================== CTCSS / DCS Decoders ====================
+
+#define SUBAUDIBLE_DECIMATION 21          // 22050 -> 1050Hz; the CIC's nulls land on every alias of the band
+#define SUBAUDIBLE_RATE (SAMPLE_RATE / SUBAUDIBLE_DECIMATION)
+#define CTCSS_BLOCK_SAMPLES 1050          // 1s at 1050Hz: ~1Hz bins, the closest tones are 2.3Hz apart
+#define CTCSS_MIN_LEVEL 100               // Tone amplitude (~-50dBFS)
+#define CTCSS_MARGIN_DB 10.0f             // Over the next strongest tone
+#define DCS_BIT_RATE 134.4f
+#define DCS_LOWPASS_HZ 300.0f
+#define DCS_MIN_WORDS 2                   // Matching words before a code counts (~0.35s)
+#define DCS_RX_INVERTED false             // Set if N and I codes come out swapped (receiver audio polarity)
+
+// ==================== MDC1200 Decoder ====================
+
+#define MDC_BAUD 1200.0f
+#define MDC_TONE_LOW_HZ 1200.0f           // Bit unchanged
+#define MDC_TONE_HIGH_HZ 1800.0f          // Bit changed
+
+// ==================== AFSK1200 Telemetry ====================
+
+#define AFSK_BAUD 1200.0f
+#define AFSK_MARK_HZ 1200.0f
+#define AFSK_SPACE_HZ 2200.0f
+#define AFSK_TXDELAY_FLAGS 30             // Flags sent before the frame (~200ms) while the far end's squelch opens
+#define AFSK_TAIL_FLAGS 3
+#define BEACON_DEST "APZPRT"              // Experimental APRS tocall
+#define BEACON_PATH "WIDE1-1"
+#define BEACON_INTERVAL_MAX_MIN 1440
+
+// ==================== Slot Storage ====================
+
+#define ARENA_PSRAM_RESERVE (256 * 1024 + TTS_RING_SAMPLES * 2)  // PSRAM left outside the arena for eSpeak, its ring, HTTP, etc.
+#define ARENA_ALIGN 16
+#define ARENA_MAX_EXTENTS 1024
+
+// Recordings are chains of fixed-size chunks allocated as audio arrives
+#define CHUNK_SAMPLES 4096  // ~186ms, 8KB as PCM; a multiple of the ADPCM block
+#define STORAGE_DECIMATION_DEFAULT 1  // Store at SAMPLE_RATE / this (1, 2 or 3)
+#define RECORD_RESERVE_BYTES (3 * SAMPLE_RATE * 2)  // Kept free after each save (~3s PCM)
+
+// Eviction policy when the arena is full (pinned slots are never evicted)
+#define EVICT_OLDEST 0
+#define EVICT_LONGEST 1
+
+// Background IMA-ADPCM compression of saved slots
+#define COMPRESS_TASK_CORE 0
+#define COMPRESS_TASK_PRIORITY 1
+#define COMPRESS_TASK_STACK 3072
 
 // ==================== WiFi Settings ====================
 
@@ -89,6 +210,7 @@ extern int radioSquelch;
 // Audio settings
 extern int samVolumePercent;
 extern int toneVolumePercent;
+extern int prerollMs;
 
 // Pin configuration (runtime)
 extern int pinPTT;
@@ -121,8 +243,15 @@ extern float lastBatteryV;
 extern int lastBatteryPct;
 
 // Recording buffers
-extern int16_t* audioBuffer;
+extern int maxRecordSeconds;
 extern int recordIndex;
+extern int recordPreroll;  // Leading samples of the recording captured before squelch opened
+extern int recordTrimStart;  // VAD trim points (sample range worth keeping)
+extern int recordTrimEnd;
+extern bool vadTrimEnabled;
+extern bool filterDcBlock;
+extern bool filterHighpass;
+extern bool filterDeemphasis;
 extern bool recording;
 
 // Signal quality tracking
@@ -132,14 +261,54 @@ extern float peakAudioLevel;
 extern int clipCount;
 
 // Recording slots
+#define SLOT_PCM16 0
+#define SLOT_ADPCM 1
+
+// Header of each chunk in a recording's chain; the audio follows it
+// (int16_t samples, or whole ADPCM blocks once compressed)
+struct AudioChunk {
+  AudioChunk* next;
+  uint16_t count;     // Samples held
+  uint16_t reserved;
+};
+
 struct RecordingSlot {
-  int16_t* buffer;
-  int sampleCount;  // 0 = empty
+  AudioChunk* chunks; // Chunk chain in the arena, last chunk shrunk to fit
+  int startOffset;    // Samples trimmed off the front of the first chunk
+  int sampleCount;    // 0 = empty
+  uint32_t sequence;  // Save order (FIFO eviction)
+  uint8_t format;     // SLOT_PCM16, or SLOT_ADPCM once compressed in the background
+  uint8_t decimation; // Stored at SAMPLE_RATE / decimation (sampleCount is in stored samples)
+  bool pinned;        // Never evicted or overwritten
+  uint8_t readers;    // Open SlotReaders
+  int trimmedSamples; // Dropped by VAD trimming when saved (at SAMPLE_RATE)
+  int32_t unitId;     // Caller's MDC1200 unit ID, -1 = none sent
 };
 extern RecordingSlot slots[MAX_SLOTS];
 extern int nextSlot;
-
-// DTMF detection
-extern char detectedDTMF;
+extern int slotEvictPolicy;
+extern bool slotCompression;
+extern int storageDecimation;
+
+// DTMF command sequence from the last recording ("" = none)
+extern char dtmfCommand[DTMF_MAX_DIGITS + 1];
+extern String dtmfAdminPin;
+extern bool dtmfLowRate;
+
+// CTCSS/DCS decoding (needs the SA868's audio high-pass bypassed) and what
+// was heard on the last recording: index into CTCSS_TONE_TABLE, dcsResult()
+// and dcsTwin() for DCS; -1 = none
+extern bool ctcssDecode;
+extern int callerCtcss;
+extern int callerDcs;
+extern int callerDcsTwin;
+
+// MDC1200 unit ID the caller's radio sent with the last recording (-1 = none)
+extern int callerUnit;
+
+// AX.25 telemetry beacon: sent every beaconIntervalMin (0 = off) once a
+// callsign is set
+extern String beaconCallsign;
+extern int beaconIntervalMin;
 
 #endif // CONFIG_H
@@ -0,0 +1,86 @@
+#include "ctcss.h"
+
+// The 50 EIA tones, with the SA868's codes for the 38 it can encode
+constexpr CtcssTone CTCSS_TONE_TABLE[CTCSS_TONES] = {
+  {67.0f, 1},   {69.3f, 0},   {71.9f, 2},   {74.4f, 3},   {77.0f, 4},
+  {79.7f, 5},   {82.5f, 6},   {85.4f, 7},   {88.5f, 8},   {91.5f, 9},
+  {94.8f, 10},  {97.4f, 11},  {100.0f, 12}, {103.5f, 13}, {107.2f, 14},
+  {110.9f, 15}, {114.8f, 16}, {118.8f, 17}, {123.0f, 18}, {127.3f, 19},
+  {131.8f, 20}, {136.5f, 21}, {141.3f, 22}, {146.2f, 23}, {151.4f, 24},
+  {156.7f, 25}, {159.8f, 0},  {162.2f, 26}, {165.5f, 0},  {167.9f, 27},
+  {171.3f, 0},  {173.8f, 28}, {177.3f, 0},  {179.9f, 29}, {183.5f, 0},
+  {186.2f, 30}, {189.9f, 0},  {192.8f, 31}, {196.6f, 0},  {199.5f, 0},
+  {203.5f, 32}, {206.5f, 0},  {210.7f, 33}, {218.1f, 34}, {225.7f, 35},
+  {229.1f, 0},  {233.6f, 36}, {241.8f, 37}, {250.3f, 38}, {254.1f, 0}
+};
+
+// The Goertzel passes run over the same tones, taken from the table in
+// tenths of a Hz
+constexpr int ctcssTenths(int tone) {
+  return (int)(CTCSS_TONE_TABLE[tone].hz * 10.0f + 0.5f);
+}
+
+template <typename Indices> struct CtcssBankOf;
+template <int... I> struct CtcssBankOf<ToneIndices<I...>> {
+  typedef ToneBank<SUBAUDIBLE_RATE, ctcssTenths(I)...> type;
+};
+typedef CtcssBankOf<MakeToneIndices<CTCSS_TONES>::type>::type CtcssBank;
+
+void ctcssReset(CtcssDecoder& dec) {
+  biquadDcBlocker(dec.dcBlock, FILTER_DC_POLE);
+  dec.fill = 0;
+  memset(dec.votes, 0, sizeof(dec.votes));
+  dec.blocks = 0;
+}
+
+// One second of decimated audio: the strongest tone gets a vote if it is
+// loud enough and stands clear of every other tone
+static void ctcssBlock(CtcssDecoder& dec) {
+  if (dec.blocks == 0) biquadPrime(dec.dcBlock, dec.block[0]);
+  biquadProcess(&dec.dcBlock, 1, dec.block, CTCSS_BLOCK_SAMPLES);
+
+  int64_t power[CTCSS_TONES];
+  CtcssBank::process(dec.block, CTCSS_BLOCK_SAMPLES, power);
+
+  int best = 0;
+  int64_t runnerUp = 0;
+  for (int t = 1; t < CTCSS_TONES; t++) {
+    if (power[t] > power[best]) {
+      runnerUp = power[best];
+      best = t;
+    } else if (power[t] > runnerUp) {
+      runnerUp = power[t];
+    }
+  }
+
+  // A tone of amplitude A gives (A * N / 2)^2
+  float minPower = (float)CTCSS_MIN_LEVEL * CTCSS_BLOCK_SAMPLES / 2.0f;
+  minPower *= minPower;
+  float margin = powf(10.0f, CTCSS_MARGIN_DB / 10.0f);
+  dec.blocks++;
+  if ((float)power[best] < minPower || (float)power[best] < (float)runnerUp * margin) return;
+  dec.votes[best]++;
+}
+
+// Feed SUBAUDIBLE_RATE samples
+void ctcssProcess(CtcssDecoder& dec, const int16_t* samples, int count) {
+  while (count > 0) {
+    int n = min(count, CTCSS_BLOCK_SAMPLES - dec.fill);
+    memcpy(&dec.block[dec.fill], samples, n * sizeof(int16_t));
+    dec.fill += n;
+    samples += n;
+    count -= n;
+    if (dec.fill < CTCSS_BLOCK_SAMPLES) break;
+    ctcssBlock(dec);
+    dec.fill = 0;
+  }
+}
+
+// The tone that won the most blocks
+int ctcssResult(const CtcssDecoder& dec) {
+  int best = -1;
+  for (int t = 0; t < CTCSS_TONES; t++) {
+    if (dec.votes[t] > 0 && (best < 0 || dec.votes[t] > dec.votes[best])) best = t;
+  }
+  return best;
+}
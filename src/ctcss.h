@@ -0,0 +1,34 @@
+#ifndef CTCSS_H
+#define CTCSS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "dsp.h"
+
+// Software CTCSS decoder: tells which sub-audible tone a caller is sending.
+// Fed the raw capture (before the CTCSS high-pass) after the CIC has taken
+// it down to SUBAUDIBLE_RATE, so the SA868 has to pass the tone through -
+// see ctcssDecode. Every 1s block goes through a Goertzel bank over the 50
+// EIA tones; each block with a clear winner is a vote.
+
+#define CTCSS_TONES 50
+
+struct CtcssTone {
+  float hz;
+  uint8_t code;  // SA868 CTCSS code (1-38), 0 if the module can't use it
+};
+extern const CtcssTone CTCSS_TONE_TABLE[CTCSS_TONES];
+
+struct CtcssDecoder {
+  Biquad dcBlock;
+  int16_t block[CTCSS_BLOCK_SAMPLES];
+  int fill;
+  uint16_t votes[CTCSS_TONES];
+  int blocks;              // Blocks decided so far (tone or not)
+};
+
+void ctcssReset(CtcssDecoder& dec);
+void ctcssProcess(CtcssDecoder& dec, const int16_t* samples, int count);
+int ctcssResult(const CtcssDecoder& dec);  // Index into CTCSS_TONE_TABLE, -1 = none
+
+#endif // CTCSS_H
@@ -0,0 +1,135 @@
+#include "dcs.h"
+
+// The standard DCS codes
+const uint16_t DCS_CODE_TABLE[DCS_CODES] = {
+  0023, 0025, 0026, 0031, 0032, 0036, 0043, 0047, 0051, 0053, 0054, 0065, 0071,
+  0072, 0073, 0074, 0114, 0115, 0116, 0122, 0125, 0131, 0132, 0134, 0143, 0145,
+  0152, 0155, 0156, 0162, 0165, 0172, 0174, 0205, 0212, 0223, 0225, 0226, 0243,
+  0244, 0245, 0246, 0251, 0252, 0255, 0261, 0263, 0265, 0266, 0271, 0274, 0306,
+  0311, 0315, 0325, 0331, 0332, 0343, 0346, 0351, 0356, 0364, 0365, 0371, 0411,
+  0412, 0413, 0423, 0431, 0432, 0445, 0446, 0452, 0454, 0455, 0462, 0464, 0465,
+  0466, 0503, 0506, 0516, 0523, 0526, 0532, 0546, 0565, 0606, 0612, 0624, 0627,
+  0631, 0632, 0654, 0662, 0664, 0703, 0712, 0723, 0731, 0732, 0734, 0743, 0754
+};
+
+#define DCS_WORD_MASK 0x7FFFFF
+
+// Golay(23,12) parity of 12 data bits, generator x^11+x^10+x^6+x^5+x^4+x^2+1
+static uint32_t golayParity(uint32_t data) {
+  uint32_t c = data & 0xFFF;
+  for (int i = 0; i < 12; i++) {
+    if (c & 1) c ^= 0xC75;
+    c >>= 1;
+  }
+  return c;
+}
+
+uint32_t dcsCodeword(uint16_t code) {
+  uint32_t data = 0x800 | (code & 0x1FF);  // Code bits, then 0, 0, 1
+  return data | (golayParity(data) << 12);
+}
+
+void dcsInit(DcsDecoder& dec, float sampleRate) {
+  dec.step = (int32_t)lroundf(65536.0f * DCS_BIT_RATE / sampleRate);
+  dcsReset(dec);
+  biquadDcBlocker(dec.filters[0], FILTER_DC_POLE);
+  biquadLowpass(dec.filters[1], DCS_LOWPASS_HZ, 0.7071f, sampleRate);
+}
+
+void dcsReset(DcsDecoder& dec) {
+  biquadPrime(dec.filters[0], 0);
+  biquadPrime(dec.filters[1], 0);
+  dec.phase = 0;
+  dec.level = false;
+  dec.shift = 0;
+  dec.bits = 0;
+  memset(dec.votes, 0, sizeof(dec.votes));
+}
+
+static int dcsCodeIndex(uint16_t code) {
+  for (int i = 0; i < DCS_CODES; i++) {
+    if (DCS_CODE_TABLE[i] == code) return i;
+  }
+  return -1;
+}
+
+// A valid word for a listed code: its index, else -1
+static int dcsMatch(uint32_t word) {
+  uint32_t data = word & 0xFFF;
+  if ((data >> 9) != 4) return -1;  // The fixed 100
+  if ((word >> 12) != golayParity(data)) return -1;
+  return dcsCodeIndex(data & 0x1FF);
+}
+
+static void dcsBit(DcsDecoder& dec, bool bit) {
+  dec.shift = (dec.shift >> 1) | ((uint32_t)bit << 22);
+  if (++dec.bits < 23) return;
+
+  int normal = dcsMatch(dec.shift);
+  int inverted = dcsMatch(~dec.shift & DCS_WORD_MASK);
+  if (normal >= 0) dec.votes[normal][DCS_RX_INVERTED ? 1 : 0]++;
+  if (inverted >= 0) dec.votes[inverted][DCS_RX_INVERTED ? 0 : 1]++;
+}
+
+// Feed SUBAUDIBLE_RATE samples
+void dcsProcess(DcsDecoder& dec, const int16_t* samples, int count) {
+  int16_t filtered[64];
+  while (count > 0) {
+    int n = min(count, 64);
+    memcpy(filtered, samples, n * sizeof(int16_t));
+    biquadProcess(dec.filters, 2, filtered, n);
+
+    for (int i = 0; i < n; i++) {
+      bool level = filtered[i] > 0;
+      if (level != dec.level) {
+        // Edges belong on the bit boundary (phase 0): pull a quarter of the way there
+        int32_t error = dec.phase < 32768 ? dec.phase : dec.phase - 65536;
+        dec.phase -= error / 4;
+        if (dec.phase < 0) dec.phase += 65536;
+        dec.level = level;
+      }
+
+      // Sample each bit in the middle
+      int32_t previous = dec.phase;
+      dec.phase += dec.step;
+      if (previous < 32768 && dec.phase >= 32768) dcsBit(dec, level);
+      if (dec.phase >= 65536) dec.phase -= 65536;
+    }
+    samples += n;
+    count -= n;
+  }
+}
+
+// The code seen in the most words; DCS_MIN_WORDS or it's noise
+int dcsResult(const DcsDecoder& dec) {
+  int best = -1;
+  int bestVotes = DCS_MIN_WORDS - 1;
+  for (int inverted = 0; inverted < 2; inverted++) {
+    for (int i = 0; i < DCS_CODES; i++) {
+      if (dec.votes[i][inverted] > bestVotes) {
+        best = i * 2 + inverted;
+        bestVotes = dec.votes[i][inverted];
+      }
+    }
+  }
+  return best;
+}
+
+// The other polarity's code that matched as often as result did
+int dcsTwin(const DcsDecoder& dec, int result) {
+  if (result < 0) return -1;
+  int inverted = !(result % 2);
+  uint16_t votes = dec.votes[result / 2][result % 2];
+  for (int i = 0; i < DCS_CODES; i++) {
+    if (dec.votes[i][inverted] == votes) return i * 2 + inverted;
+  }
+  return -1;
+}
+
+void dcsCodeName(int result, char* name) {
+  if (result < 0) {
+    name[0] = 0;
+    return;
+  }
+  snprintf(name, 5, "%03o%c", DCS_CODE_TABLE[result / 2] & 0777, result % 2 ? 'I' : 'N');
+}
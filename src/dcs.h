@@ -0,0 +1,43 @@
+#ifndef DCS_H
+#define DCS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "dsp.h"
+
+// DCS (digital coded squelch) decoder. The code is a 23-bit Golay(23,12)
+// word - 9 code bits, the fixed bits 100, 11 parity bits, LSB first - sent
+// over and over as 134.4 bps NRZ below 300Hz, inverted for the "I" codes.
+// Fed the same SUBAUDIBLE_RATE stream as the CTCSS decoder: low-pass, slice,
+// recover the bit clock, then every bit check whether the last 23 form a
+// valid word (either polarity) for a code on the standard list.
+//
+// A word's rotations can be valid words too (023N, 340N and 766N are the
+// same bit stream) and every inverted code on the list is a rotation of a
+// normal one (023N = 047I, 116N = 754I). Radios can't tell them apart
+// either, so ties go to the normal code and then the lowest number, and
+// dcsTwin() gives the other polarity's code for the same signal.
+
+#define DCS_CODES 104
+
+extern const uint16_t DCS_CODE_TABLE[DCS_CODES];  // Octal, as written on the radio
+
+struct DcsDecoder {
+  Biquad filters[2];      // DC blocker, then the low-pass
+  int32_t phase;          // Bit clock, 0..65535 over one bit
+  int32_t step;
+  bool level;             // Slicer output for the last sample
+  uint32_t shift;         // Last 23 bits, the newest in bit 22
+  int bits;
+  uint16_t votes[DCS_CODES][2];  // [code][inverted]
+};
+
+uint32_t dcsCodeword(uint16_t code);  // Octal code -> 23-bit word, first bit in bit 0
+void dcsInit(DcsDecoder& dec, float sampleRate);
+void dcsReset(DcsDecoder& dec);
+void dcsProcess(DcsDecoder& dec, const int16_t* samples, int count);
+int dcsResult(const DcsDecoder& dec);  // index * 2 + inverted, -1 = none
+int dcsTwin(const DcsDecoder& dec, int result);  // Same signal, other polarity
+void dcsCodeName(int result, char* name);  // "023N", "754I"; name holds 5
+
+#endif // DCS_H
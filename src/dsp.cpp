@@ -0,0 +1,406 @@
+#include "dsp.h"
+#include "config.h"
+#include <esp_attr.h>
+
+// ==================== Block Statistics ====================
+
+static uint32_t isqrt32(uint32_t n) {
+  uint32_t root = 0, bit = 1UL << 30;
+  while (bit > n) bit >>= 2;
+  while (bit) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// Integer only, and every accumulator is an independent reduction with no
+// branches in the loop. Xtensa has no SIMD, so there the win is a tight loop
+// of loads, MULs and MINs instead of two abs() and a float divide per
+// sample. GCC vectorizes it wherever the tree vectorizer runs (-O3/-Ofast,
+// or -ftree-vectorize as the native test build adds); plain -O2 leaves it
+// scalar.
+void blockLevel(const int16_t* block, int count, BlockLevel& level) {
+  int32_t peak = 0;
+  int32_t clips = 0;
+  int32_t sum = 0;
+  int64_t sumSquares = 0;
+
+  for (int i = 0; i < count; i++) {
+    int32_t x = block[i];
+    int32_t a = x < 0 ? -x : x;
+    peak = a > peak ? a : peak;
+    clips += a > CLIP_THRESHOLD;
+    sum += x;
+    sumSquares += x * x;
+  }
+
+  if (count <= 0) {
+    level = BlockLevel();
+    return;
+  }
+  int32_t mean = sum / count;
+  int64_t variance = sumSquares / count - (int64_t)mean * mean;
+  level.peak = (int16_t)min(peak, (int32_t)32767);
+  level.rms = (int16_t)min(isqrt32((uint32_t)max(variance, (int64_t)0)), (uint32_t)32767);
+  level.dc = (int16_t)mean;
+  level.clips = (uint16_t)clips;
+}
+
+// ==================== Voice Activity ====================
+
+void vadReset(VadState& vad) {
+  vad.noiseFloor = UINT32_MAX;
+  vad.speechStart = -1;
+  vad.speechEnd = -1;
+  vad.speechBlocks = 0;
+}
+
+// A block counts as speech when it is loud enough, clearly above the
+// quietest block before it, and not noise-like. Noise-likeness is the ratio of
+// first-difference energy to signal energy - a cheap stand-in for spectral
+// flatness: ~0.05-0.3 for voice (energy below ~2kHz), towards 1.0 for the
+// broadband hiss of an FM squelch tail.
+void vadProcess(VadState& vad, const int16_t* block, int count, int position, const BlockLevel& level) {
+  if (count < 2) return;
+
+  // Differencing removes DC, so only the signal energy needs the block mean
+  uint64_t diffEnergy = 0;
+  for (int i = 1; i < count; i++) {
+    int32_t d = block[i] - block[i - 1];
+    diffEnergy += (int64_t)d * d;
+  }
+
+  uint32_t meanSquare = (uint32_t)level.rms * level.rms;
+  uint64_t energy = (uint64_t)meanSquare * (count - 1);
+
+  // Judged against the floor of the blocks before it (the pre-roll, when
+  // there is one), and only then allowed to lower it - otherwise a block
+  // could never be louder than the floor it just set. The first block has
+  // no floor to beat and goes on level and flatness alone.
+  bool loud = meanSquare >= (uint32_t)VAD_MIN_RMS * VAD_MIN_RMS &&
+              (vad.noiseFloor == UINT32_MAX || meanSquare >= (uint64_t)vad.noiseFloor * VAD_SNR_RATIO);
+  if (meanSquare < vad.noiseFloor) vad.noiseFloor = meanSquare;
+  // diffEnergy / (2 * energy) < VAD_MAX_FLATNESS / 100, without dividing
+  bool voiced = diffEnergy * 100 < energy * 2 * VAD_MAX_FLATNESS;
+
+  if (loud && voiced) {
+    if (vad.speechStart < 0) vad.speechStart = position;
+    vad.speechEnd = position + count;
+    vad.speechBlocks++;
+  }
+}
+
+// Trim points with a little margin either side of the detected speech.
+// Returns false (keep everything) when no speech was found at all.
+bool vadTrimPoints(const VadState& vad, int totalSamples, int& start, int& end) {
+  start = 0;
+  end = totalSamples;
+  if (vad.speechStart < 0 || vad.speechBlocks < VAD_MIN_SPEECH_BLOCKS) return false;
+
+  start = max(0, vad.speechStart - VAD_LEAD_MARGIN);
+  end = min(totalSamples, vad.speechEnd + VAD_TAIL_MARGIN);
+  return true;
+}
+
+// ==================== Biquad Filters ====================
+
+static void biquadSet(Biquad& bq, float b0, float b1, float b2, float a0, float a1, float a2) {
+  memset(&bq, 0, sizeof(bq));
+  bq.b0 = (int16_t)constrain(lroundf(b0 / a0 * 16384.0f), -32768L, 32767L);
+  bq.b1 = (int16_t)constrain(lroundf(b1 / a0 * 16384.0f), -32768L, 32767L);
+  bq.b2 = (int16_t)constrain(lroundf(b2 / a0 * 16384.0f), -32768L, 32767L);
+  bq.a1 = (int16_t)constrain(lroundf(a1 / a0 * 16384.0f), -32768L, 32767L);
+  bq.a2 = (int16_t)constrain(lroundf(a2 / a0 * 16384.0f), -32768L, 32767L);
+}
+
+// First-order: y = x - x1 + pole * y1
+void biquadDcBlocker(Biquad& bq, float pole) {
+  biquadSet(bq, 1.0f, -1.0f, 0.0f, 1.0f, -pole, 0.0f);
+}
+
+// RBJ cookbook high-pass
+void biquadHighpass(Biquad& bq, float cutoffHz, float q) {
+  float w0 = 2.0f * PI * cutoffHz / SAMPLE_RATE;
+  float cosw = cosf(w0);
+  float alpha = sinf(w0) / (2.0f * q);
+  biquadSet(bq, (1.0f + cosw) / 2.0f, -(1.0f + cosw), (1.0f + cosw) / 2.0f,
+            1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+}
+
+// RBJ cookbook low-pass, for filters that run at a decimated rate
+void biquadLowpass(Biquad& bq, float cutoffHz, float q, float sampleRate) {
+  float w0 = 2.0f * PI * cutoffHz / sampleRate;
+  float cosw = cosf(w0);
+  float alpha = sinf(w0) / (2.0f * q);
+  biquadSet(bq, (1.0f - cosw) / 2.0f, 1.0f - cosw, (1.0f - cosw) / 2.0f,
+            1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+}
+
+// FM de-emphasis: one pole at 1/(2 pi tau), a zero at zeroHz to level off
+// above the voice band, bilinear transformed and 0dB at 1kHz
+void biquadDeemphasis(Biquad& bq, float tauUs, float zeroHz) {
+  float k = 2.0f * SAMPLE_RATE;
+  float tau = tauUs * 1e-6f;
+  float tz = 1.0f / (2.0f * PI * zeroHz);
+  float b0 = 1.0f + k * tz, b1 = 1.0f - k * tz;
+  float a0 = 1.0f + k * tau, a1 = 1.0f - k * tau;
+
+  float w = 2.0f * PI * 1000.0f / SAMPLE_RATE;
+  float numRe = b0 + b1 * cosf(w), numIm = -b1 * sinf(w);
+  float denRe = a0 + a1 * cosf(w), denIm = -a1 * sinf(w);
+  float gain = sqrtf((denRe * denRe + denIm * denIm) / (numRe * numRe + numIm * numIm));
+  biquadSet(bq, b0 * gain, b1 * gain, 0.0f, a0, a1, 0.0f);
+}
+
+// Start as if the input had been x forever (and a high-pass had settled to 0),
+// so the first block doesn't ring on the DC offset
+void biquadPrime(Biquad& bq, int16_t x) {
+  bq.x1 = bq.x2 = x;
+  bq.y1 = bq.y2 = 0;
+  bq.error = 0;
+}
+
+void biquadProcess(Biquad* stages, int stageCount, int16_t* samples, int count) {
+  for (int s = 0; s < stageCount; s++) {
+    Biquad& bq = stages[s];
+    int32_t x1 = bq.x1, x2 = bq.x2, y1 = bq.y1, y2 = bq.y2, error = bq.error;
+    for (int i = 0; i < count; i++) {
+      int32_t x = samples[i];
+      int64_t acc = (int64_t)bq.b0 * x + (int64_t)bq.b1 * x1 + (int64_t)bq.b2 * x2 -
+                    (int64_t)bq.a1 * y1 - (int64_t)bq.a2 * y2 + error;
+      int32_t y = (int32_t)(acc >> 14);
+      error = (int32_t)(acc - (int64_t)y * 16384);
+      y = constrain(y, -32768, 32767);
+      x2 = x1;
+      x1 = x;
+      y2 = y1;
+      y1 = y;
+      samples[i] = (int16_t)y;
+    }
+    bq.x1 = x1;
+    bq.x2 = x2;
+    bq.y1 = y1;
+    bq.y2 = y2;
+    bq.error = error;
+  }
+}
+
+// ==================== CIC Decimator ====================
+
+void cicReset(CicDecimator& cic, int factor) {
+  memset(&cic, 0, sizeof(cic));
+  cic.factor = max(factor, 1);
+}
+
+// Returns the number of samples written to out (count / factor, give or take one)
+int cicDecimate(CicDecimator& cic, const int16_t* in, int count, int16_t* out) {
+  int32_t gain = cic.factor * cic.factor * cic.factor;
+  uint32_t i0 = cic.integrator[0], i1 = cic.integrator[1], i2 = cic.integrator[2];
+  int produced = 0;
+  for (int i = 0; i < count; i++) {
+    i0 += (uint32_t)(int32_t)in[i];
+    i1 += i0;
+    i2 += i1;
+    if (++cic.phase < cic.factor) continue;
+    cic.phase = 0;
+
+    uint32_t d0 = i2 - cic.comb[0];
+    cic.comb[0] = i2;
+    uint32_t d1 = d0 - cic.comb[1];
+    cic.comb[1] = d0;
+    uint32_t d2 = d1 - cic.comb[2];
+    cic.comb[2] = d1;
+    out[produced++] = (int16_t)((int32_t)d2 / gain);
+  }
+  cic.integrator[0] = i0;
+  cic.integrator[1] = i1;
+  cic.integrator[2] = i2;
+  return produced;
+}
+
+// ==================== Resampling ====================
+
+#define RESAMPLE_CUTOFF (SAMPLE_RATE / 6.0f)  // Half way between 3kHz and SAMPLE_RATE/3 - 3kHz
+#define RESAMPLE_KAISER_BETA 5.65f            // ~60dB stop band
+
+// Prototype lowpass in Q15, and its polyphase branches with gain = factor
+// (so interpolating by zero-stuffing keeps the level) for each factor
+static int16_t lowpass[RESAMPLE_TAPS];
+static int32_t branches[RESAMPLE_MAX_FACTOR + 1][RESAMPLE_MAX_FACTOR][RESAMPLE_BRANCH_TAPS];
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static float besselI0(float x) {
+  float sum = 1.0f, term = 1.0f;
+  for (int k = 1; k < 20; k++) {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+  }
+  return sum;
+}
+
+// Kaiser-windowed sinc in Q15, unity gain at DC with the rounding error
+// folded into the centre tap
+void designLowpass(int16_t* taps, int count, float cutoffHz, float sampleRate, float kaiserBeta) {
+  float window[RESAMPLE_TAPS];
+  float total = 0;
+  count = min(count, RESAMPLE_TAPS);
+  float mid = (count - 1) / 2.0f;
+  float fc = cutoffHz / sampleRate;
+  for (int i = 0; i < count; i++) {
+    float n = i - mid;
+    float sinc = n == 0 ? 2.0f * fc : sinf(2.0f * PI * fc * n) / (PI * n);
+    float r = n / mid;
+    window[i] = sinc * besselI0(kaiserBeta * sqrtf(1.0f - r * r)) / besselI0(kaiserBeta);
+    total += window[i];
+  }
+
+  int32_t sum = 0;
+  for (int i = 0; i < count; i++) {
+    taps[i] = (int16_t)lroundf(window[i] / total * 32768.0f);
+    sum += taps[i];
+  }
+  taps[count / 2] += 32768 - sum;
+}
+
+void initResampler() {
+  designLowpass(lowpass, RESAMPLE_TAPS, RESAMPLE_CUTOFF, SAMPLE_RATE, RESAMPLE_KAISER_BETA);
+
+  for (int factor = 2; factor <= RESAMPLE_MAX_FACTOR; factor++) {
+    for (int p = 0; p < factor; p++) {
+      for (int k = 0; k < RESAMPLE_BRANCH_TAPS; k++) {
+        int tap = p + k * factor;
+        branches[factor][p][k] = tap < RESAMPLE_TAPS ? lowpass[tap] * factor : 0;
+      }
+    }
+  }
+}
+
+static inline int16_t saturate15(int32_t acc) {
+  acc = (acc + (1 << 14)) >> 15;
+  return (int16_t)constrain(acc, -32768, 32767);
+}
+
+void decimatorReset(Decimator& dec, int factor) {
+  decimatorInit(dec, factor, lowpass, RESAMPLE_TAPS);
+}
+
+// A shorter filter is fine where less stop band will do (see dtmf.cpp)
+void decimatorInit(Decimator& dec, int factor, const int16_t* taps, int tapCount) {
+  memset(&dec, 0, sizeof(dec));
+  dec.factor = constrain(factor, 1, RESAMPLE_MAX_FACTOR);
+  dec.taps = taps;
+  dec.tapCount = constrain(tapCount, 1, RESAMPLE_TAPS);
+}
+
+// Filters only the samples that are kept. Returns the number written to out.
+int decimate(Decimator& dec, const int16_t* in, int count, int16_t* out) {
+  if (dec.factor <= 1) {
+    memcpy(out, in, count * sizeof(int16_t));
+    return count;
+  }
+  const int16_t* taps = dec.taps;
+  int tapCount = dec.tapCount;
+  int produced = 0;
+  for (int i = 0; i < count; i++) {
+    dec.pos = dec.pos == 0 ? tapCount - 1 : dec.pos - 1;
+    dec.history[dec.pos] = dec.history[dec.pos + tapCount] = in[i];
+    if (++dec.phase < dec.factor) continue;
+    dec.phase = 0;
+
+    const int16_t* window = &dec.history[dec.pos];
+    int32_t acc = 0;
+    for (int k = 0; k < tapCount; k++) {
+      acc += (int32_t)taps[k] * window[k];
+    }
+    out[produced++] = saturate15(acc);
+  }
+  return produced;
+}
+
+void interpolatorReset(Interpolator& interp, int factor) {
+  memset(&interp, 0, sizeof(interp));
+  interp.factor = constrain(factor, 1, RESAMPLE_MAX_FACTOR);
+}
+
+// Writes count * factor samples to out
+int interpolate(Interpolator& interp, const int16_t* in, int count, int16_t* out) {
+  int factor = interp.factor;
+  if (factor <= 1) {
+    memcpy(out, in, count * sizeof(int16_t));
+    return count;
+  }
+  int branchTaps = (RESAMPLE_TAPS + factor - 1) / factor;
+  int produced = 0;
+  for (int i = 0; i < count; i++) {
+    interp.pos = interp.pos == 0 ? branchTaps - 1 : interp.pos - 1;
+    interp.history[interp.pos] = interp.history[interp.pos + branchTaps] = in[i];
+
+    const int16_t* window = &interp.history[interp.pos];
+    for (int p = 0; p < factor; p++) {
+      const int32_t* taps = branches[factor][p];
+      int32_t acc = 0;
+      for (int k = 0; k < branchTaps; k++) {
+        acc += taps[k] * window[k];
+      }
+      out[produced++] = saturate15(acc);
+    }
+  }
+  return produced;
+}
+
+// ==================== Tone Oscillator ====================
+
+static int16_t sineCycle[SINE_TABLE_SIZE + 1];  // Last entry repeats the first, for interpolating
+static bool sineCycleReady = false;
+
+const int16_t* sineTable() {
+  if (!sineCycleReady) {
+    for (int i = 0; i <= SINE_TABLE_SIZE; i++) {
+      sineCycle[i] = (int16_t)lroundf(32767.0f * sinf(2.0f * PI * i / SINE_TABLE_SIZE));
+    }
+    sineCycleReady = true;
+  }
+  return sineCycle;
+}
+
+static inline int32_t sineAt(const int16_t* table, uint32_t phase) {
+  int index = phase >> 24;
+  int32_t frac = (phase >> 8) & 0xFFFF;
+  int32_t a = table[index];
+  return a + (((table[index + 1] - a) * frac) >> 16);
+}
+
+void toneStart(ToneOsc& osc, float hz, int amplitude, int lengthSamples, int rampSamples, float sampleRate) {
+  sineTable();
+  osc.phase = 0;
+  osc.step = (uint32_t)(4294967296.0 * hz / sampleRate);
+  osc.amplitude = constrain(amplitude, 0, 32767);
+  osc.position = 0;
+  osc.length = max(lengthSamples, 0);
+  osc.ramp = constrain(rampSamples, 1, max(osc.length / 2, 1));
+  osc.rampStep = 0x40000000u / osc.ramp;
+}
+
+int toneRender(ToneOsc& osc, int16_t* out, int maxSamples) {
+  int count = min(maxSamples, osc.length - osc.position);
+  for (int i = 0; i < count; i++) {
+    int32_t value = (sineAt(sineCycle, osc.phase) * osc.amplitude) >> 15;
+    osc.phase += osc.step;
+
+    // sin^2 over the first and last ramp samples
+    int edge = min(osc.position, osc.length - 1 - osc.position);
+    if (edge < osc.ramp) {
+      int32_t e = sineAt(sineCycle, (uint32_t)edge * osc.rampStep);
+      value = (value * ((e * e) >> 15)) >> 15;
+    }
+    osc.position++;
+    out[i] = (int16_t)value;
+  }
+  return count;
+}
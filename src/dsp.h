@@ -0,0 +1,233 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <Arduino.h>
+
+// ==================== Block Statistics ====================
+// One record per capture block (256 samples, ~12ms). Shared by the level
+// and clip meters and the VAD.
+
+struct BlockLevel {
+  int16_t peak;    // Largest |sample| (32767 for -32768)
+  int16_t rms;     // With DC removed
+  int16_t dc;      // Mean
+  uint16_t clips;  // Samples beyond CLIP_THRESHOLD
+};
+
+void blockLevel(const int16_t* block, int count, BlockLevel& level);
+
+// ==================== Voice Activity ====================
+// Runs block by block during capture and remembers where speech started
+// and stopped, so leading dead carrier and the trailing squelch-tail noise
+// burst can be trimmed off before the recording is stored.
+
+struct VadState {
+  uint32_t noiseFloor;   // Lowest block mean-square seen so far
+  int speechStart;       // Sample index of the first speech block (-1 = none yet)
+  int speechEnd;         // Sample index just past the last speech block
+  int speechBlocks;
+};
+
+void vadReset(VadState& vad);
+void vadProcess(VadState& vad, const int16_t* block, int count, int position, const BlockLevel& level);
+bool vadTrimPoints(const VadState& vad, int totalSamples, int& start, int& end);
+
+// ==================== Biquad Filters ====================
+// Q14 coefficients (so |a1| up to 2 fits), 16-bit samples in and out, int64
+// accumulator and the rounding error fed back into the next sample so
+// low-frequency poles near 1 don't stall on quantization.
+
+#define BIQUAD_MAX_STAGES 4
+
+struct Biquad {
+  int16_t b0, b1, b2, a1, a2;  // y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+  int16_t x1, x2, y1, y2;
+  int32_t error;
+};
+
+void biquadDcBlocker(Biquad& bq, float pole);
+void biquadHighpass(Biquad& bq, float cutoffHz, float q);
+void biquadDeemphasis(Biquad& bq, float tauUs, float zeroHz);
+void biquadLowpass(Biquad& bq, float cutoffHz, float q, float sampleRate);
+void biquadPrime(Biquad& bq, int16_t x);
+void biquadProcess(Biquad* stages, int stageCount, int16_t* samples, int count);
+
+// ==================== Goertzel Bank ====================
+// Several Goertzel filters updated together in one pass over a block: Q30
+// coefficients, int32 state and int64 products, no floats in the loop.
+// Power comes out on the same scale as the textbook float version.
+//
+// ToneBank<sampleRate, tones...> fixes the tones (in tenths of a Hz) and
+// the rate at compile time: the coefficients are a constexpr table, worked
+// out by the compiler, and every pass is unrolled for its tone count.
+
+#define GOERTZEL_MAX_TONES 8  // Per pass, so the filter state stays in registers
+
+// cos(x) for 0 <= x <= pi, as a Taylor series about 0 or pi (C++11 constexpr
+// allows one return statement, hence the recursion)
+constexpr double goertzelCosSeries(double x2, double term, int n) {
+  return n > 24 ? term : term + goertzelCosSeries(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+}
+constexpr double goertzelCos(double x) {
+  return x > 3.14159265358979323846 / 2
+    ? -goertzelCosSeries((3.14159265358979323846 - x) * (3.14159265358979323846 - x), 1.0, 0)
+    : goertzelCosSeries(x * x, 1.0, 0);
+}
+constexpr int32_t goertzelQ30(double coeff) {
+  return (int32_t)(coeff * (1L << 30) + (coeff < 0 ? -0.5 : 0.5));
+}
+// 2 cos(w) in Q30
+constexpr int32_t goertzelCoeff(double hz, double sampleRate) {
+  return goertzelQ30(2.0 * goertzelCos(2.0 * 3.14159265358979323846 * hz / sampleRate));
+}
+
+constexpr bool goertzelTonesFit(long) {
+  return true;
+}
+template <typename... Rest>
+constexpr bool goertzelTonesFit(long sampleRate, int tenthsHz, Rest... rest) {
+  return tenthsHz > 0 && tenthsHz * 2L < sampleRate * 10L && goertzelTonesFit(sampleRate, rest...);
+}
+
+// One pass over the block for up to GOERTZEL_MAX_TONES tones. In IRAM so
+// the inner loop never waits on a flash cache miss - it runs on every DTMF
+// block while recording.
+template <int Tones>
+void IRAM_ATTR goertzelPass(const int32_t* coeff, const int16_t* samples, int count, int64_t* power) {
+  int32_t s1[Tones] = {};
+  int32_t s2[Tones] = {};
+
+  for (int i = 0; i < count; i++) {
+    int32_t x = samples[i];
+    for (int t = 0; t < Tones; t++) {
+      int32_t s0 = x + (int32_t)(((int64_t)coeff[t] * s1[t]) >> 30) - s2[t];
+      s2[t] = s1[t];
+      s1[t] = s0;
+    }
+  }
+
+  // Magnitude squared: s1^2 + s2^2 - coeff * s1 * s2
+  for (int t = 0; t < Tones; t++) {
+    int64_t cross = (((int64_t)coeff[t] * s1[t]) >> 30) * s2[t];
+    power[t] = (int64_t)s1[t] * s1[t] + (int64_t)s2[t] * s2[t] - cross;
+  }
+}
+
+// Bigger banks take several passes
+template <int Tones, bool Split = (Tones > GOERTZEL_MAX_TONES)>
+struct GoertzelPasses {
+  static void run(const int32_t* coeff, const int16_t* samples, int count, int64_t* power) {
+    goertzelPass<Tones>(coeff, samples, count, power);
+  }
+};
+
+template <int Tones>
+struct GoertzelPasses<Tones, true> {
+  static void run(const int32_t* coeff, const int16_t* samples, int count, int64_t* power) {
+    goertzelPass<GOERTZEL_MAX_TONES>(coeff, samples, count, power);
+    GoertzelPasses<Tones - GOERTZEL_MAX_TONES>::run(coeff + GOERTZEL_MAX_TONES, samples, count,
+                                                   power + GOERTZEL_MAX_TONES);
+  }
+};
+
+template <long SampleRate, int... TenthsHz>
+struct ToneBank {
+  static_assert(sizeof...(TenthsHz) > 0, "a tone bank needs at least one tone");
+  static_assert(goertzelTonesFit(SampleRate, TenthsHz...), "tones must lie between 0Hz and half the sample rate");
+
+  static constexpr int TONES = sizeof...(TenthsHz);
+  static constexpr int TENTHS[sizeof...(TenthsHz)] = {TenthsHz...};
+  static constexpr int32_t COEFF[sizeof...(TenthsHz)] = {goertzelCoeff(TenthsHz / 10.0, SampleRate)...};
+
+  static float hz(int tone) { return TENTHS[tone] / 10.0f; }
+
+  // power[] gets one entry per tone, in order
+  static void process(const int16_t* samples, int count, int64_t* power) {
+    GoertzelPasses<sizeof...(TenthsHz)>::run(COEFF, samples, count, power);
+  }
+};
+
+// 0 to N-1 as a parameter pack, for building a bank from a constexpr table
+// of tones (C++11 has no std::index_sequence)
+template <int... I> struct ToneIndices {};
+template <int N, int... I> struct MakeToneIndices : MakeToneIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeToneIndices<0, I...> { typedef ToneIndices<I...> type; };
+
+template <long SampleRate, int... TenthsHz>
+constexpr int ToneBank<SampleRate, TenthsHz...>::TENTHS[sizeof...(TenthsHz)];
+template <long SampleRate, int... TenthsHz>
+constexpr int32_t ToneBank<SampleRate, TenthsHz...>::COEFF[sizeof...(TenthsHz)];
+
+// ==================== CIC Decimator ====================
+// Three integrator/comb stages, adds only, for taking the capture down to
+// the sub-audible band (CTCSS, DCS). The sinc^3 response puts a null on
+// every alias of what's kept. factor^3 must stay under 65536.
+
+struct CicDecimator {
+  uint32_t integrator[3];  // Wrapping on purpose; the combs cancel it out
+  uint32_t comb[3];
+  int factor;
+  int phase;
+};
+
+void cicReset(CicDecimator& cic, int factor);
+int cicDecimate(CicDecimator& cic, const int16_t* in, int count, int16_t* out);
+
+// ==================== Resampling ====================
+// Recordings can be stored at SAMPLE_RATE / 2 or / 3 - the radio only
+// passes ~300-3000Hz anyway. One windowed-sinc lowpass (flat to 3kHz, stop
+// band from SAMPLE_RATE/3 - 3kHz) is the anti-alias filter going down and,
+// split into polyphase branches, the interpolation filter coming back up.
+
+#define RESAMPLE_TAPS 63
+#define RESAMPLE_MAX_FACTOR 3
+#define RESAMPLE_BRANCH_TAPS ((RESAMPLE_TAPS + 1) / 2)  // Longest branch (factor 2)
+
+struct Decimator {
+  uint8_t factor;
+  uint8_t phase;        // Inputs since the last output
+  uint8_t tapCount;     // Up to RESAMPLE_TAPS
+  const int16_t* taps;  // Q15 lowpass, the resampler's unless given one
+  int pos;              // Newest sample in history[pos] (and history[pos + tapCount])
+  int16_t history[2 * RESAMPLE_TAPS];
+};
+
+struct Interpolator {
+  uint8_t factor;
+  int pos;
+  int16_t history[2 * RESAMPLE_BRANCH_TAPS];
+};
+
+void designLowpass(int16_t* taps, int count, float cutoffHz, float sampleRate, float kaiserBeta);
+void initResampler();
+void decimatorReset(Decimator& dec, int factor);
+void decimatorInit(Decimator& dec, int factor, const int16_t* taps, int tapCount);
+int decimate(Decimator& dec, const int16_t* in, int count, int16_t* out);
+void interpolatorReset(Interpolator& interp, int factor);
+int interpolate(Interpolator& interp, const int16_t* in, int count, int16_t* out);
+
+// ==================== Tone Oscillator ====================
+// Wavetable NCO: a 32-bit phase accumulator picks the entry of one Q15 sine
+// cycle with its top 8 bits and interpolates towards the next with the 16
+// below (within 4 LSB of a true sine, spurs under -75dB). Every tone gets
+// raised-cosine attack and release ramps, so it starts and stops without a
+// click. No floats per sample.
+
+#define SINE_TABLE_SIZE 256
+
+const int16_t* sineTable();  // Filled on first use; the FSK modem shares it
+
+struct ToneOsc {
+  uint32_t phase;
+  uint32_t step;        // Per sample, 2^32 = one cycle
+  int32_t amplitude;
+  int position;         // Samples rendered so far
+  int length;           // Samples in the whole tone
+  int ramp;             // Attack and release, each
+  uint32_t rampStep;    // Envelope phase per sample: a quarter cycle over the ramp
+};
+
+void toneStart(ToneOsc& osc, float hz, int amplitude, int lengthSamples, int rampSamples, float sampleRate);
+int toneRender(ToneOsc& osc, int16_t* out, int maxSamples);  // Returns samples written, 0 once the tone is over
+
+#endif // DSP_H
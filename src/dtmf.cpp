@@ -0,0 +1,244 @@
+#include "dtmf.h"
+
+// A tone's 2nd harmonic has the same coefficient as the tone itself at
+// half the rate
+#define DTMF_LOW_RATE (SAMPLE_RATE / DTMF_DECIMATION)
+static_assert(SAMPLE_RATE % 2 == 0 && DTMF_LOW_RATE % 2 == 0, "harmonic tables need an even rate");
+static_assert(SAMPLE_RATE % DTMF_DECIMATION == 0, "the low rate has to be exact");
+
+// Row/column mapping to digits
+static const char DTMF_CHARS[4][4] = {
+  {'1', '2', '3', 'A'},
+  {'4', '5', '6', 'B'},
+  {'7', '8', '9', 'C'},
+  {'*', '0', '#', 'D'}
+};
+
+static inline float dbToPower(float db) {
+  return powf(10.0f, db / 10.0f);
+}
+
+// Lowpass ahead of the decimated path. It only has to keep what would
+// alias onto the tones out; the 2nd harmonics near the top of the band
+// lose a few dB, which harmonicGain puts back.
+static int16_t lowRateTaps[DTMF_LOW_RATE_TAPS];
+
+// Power gain of a Q15 FIR at one frequency
+static float firPowerGain(const int16_t* taps, int count, float freq, float sampleRate) {
+  float re = 0, im = 0;
+  for (int k = 0; k < count; k++) {
+    float w = 2.0f * PI * freq * k / sampleRate;
+    re += taps[k] * cosf(w);
+    im -= taps[k] * sinf(w);
+  }
+  return (re * re + im * im) / (32768.0f * 32768.0f);
+}
+
+void dtmfInit(DtmfDetector& det, int blockSize, bool lowRate) {
+  det.decimation = lowRate ? DTMF_DECIMATION : 1;
+  det.sampleRate = (float)SAMPLE_RATE / det.decimation;
+  det.blockSize = constrain(blockSize, 1, DTMF_BLOCK_SIZE);
+  det.coeff = lowRate ? DtmfTones<DTMF_LOW_RATE>::COEFF : DtmfTones<SAMPLE_RATE>::COEFF;
+  det.harmonicCoeff = lowRate ? DtmfTones<DTMF_LOW_RATE / 2>::COEFF : DtmfTones<SAMPLE_RATE / 2>::COEFF;
+  if (lowRate) {
+    designLowpass(lowRateTaps, DTMF_LOW_RATE_TAPS, DTMF_LOW_RATE_CUTOFF_HZ, SAMPLE_RATE, DTMF_LOW_RATE_KAISER_BETA);
+  }
+  for (int t = 0; t < 8; t++) {
+    float hz = DtmfTones<SAMPLE_RATE>::hz(t);
+    det.harmonicGain[t] = 1.0f;
+    if (lowRate) {
+      det.harmonicGain[t] = firPowerGain(lowRateTaps, DTMF_LOW_RATE_TAPS, 2.0f * hz, SAMPLE_RATE) /
+                            firPowerGain(lowRateTaps, DTMF_LOW_RATE_TAPS, hz, SAMPLE_RATE);
+    }
+  }
+  dtmfReset(det);
+}
+
+void dtmfReset(DtmfDetector& det) {
+  decimatorInit(det.decimator, det.decimation, lowRateTaps, DTMF_LOW_RATE_TAPS);
+  det.fill = 0;
+  det.position = 0;
+  det.blockPower = 0;
+  det.candidate = 0;
+  det.candidatePower = 0;
+  det.candidateBlocks = 0;
+  det.candidateStart = 0;
+  det.active = 0;
+  det.offBlocks = 0;
+}
+
+static int strongest(const int64_t* power, int first) {
+  int best = first;
+  for (int i = first + 1; i < first + 4; i++) {
+    if (power[i] > power[best]) best = i;
+  }
+  return best;
+}
+
+// Which digit (if any) one block holds, with no timing rules applied
+char dtmfClassifyBlock(DtmfDetector& det, const int16_t* block, int count) {
+  int64_t power[8];
+  goertzelPass<8>(det.coeff, block, count, power);
+  int row = strongest(power, 0);
+  int col = strongest(power, 4);
+  float rowPower = (float)power[row];
+  float colPower = (float)power[col];
+  det.blockPower = rowPower + colPower;
+
+  // Both tones loud enough: a tone of amplitude A gives (A * N / 2)^2
+  float minPower = (float)DTMF_MIN_LEVEL * count / 2.0f;
+  minPower *= minPower;
+  if (rowPower < minPower || colPower < minPower) return 0;
+
+  // Twist: the column tone may be up to 9dB weaker, the row up to 4dB. A
+  // block that isn't a whole number of cycles reads a steady tone up to ~1dB
+  // high or low, so the normal-twist limit carries that on top of 8dB.
+  if (rowPower > colPower * dbToPower(DTMF_MAX_TWIST_DB)) return 0;
+  if (colPower > rowPower * dbToPower(DTMF_MAX_REVERSE_TWIST_DB)) return 0;
+
+  // Each must stand well clear of the other tones in its group
+  float peak = dbToPower(DTMF_RELATIVE_PEAK_DB);
+  for (int i = 0; i < 8; i++) {
+    if (i == row || i == col) continue;
+    if ((float)power[i] * peak > (i < 4 ? rowPower : colPower)) return 0;
+  }
+
+  // The two tones have to carry most of the block's energy (speech and
+  // noise spread theirs about). A tone's energy is 2P/N in Goertzel terms.
+  int64_t energy = 0;
+  for (int i = 0; i < count; i++) {
+    energy += (int32_t)block[i] * block[i];
+  }
+  if ((rowPower + colPower) * 2.0f / count * 100.0f < (float)energy * DTMF_MIN_TONE_PERCENT) return 0;
+
+  // Voiced speech has strong harmonics, real DTMF doesn't. A row tone's
+  // harmonic within a bin and a half of the column tone (697Hz x 2 next to
+  // 1336Hz) can't be told apart from it, so that one is left unchecked.
+  float binHz = det.sampleRate / count;
+  bool checkRow = fabsf(2.0f * DtmfTones<SAMPLE_RATE>::hz(row) - DtmfTones<SAMPLE_RATE>::hz(col)) > 1.5f * binHz;
+  int32_t harmonicCoeff[2] = {det.harmonicCoeff[row], det.harmonicCoeff[col]};
+  int64_t harmonicPower[2];
+  if (checkRow) {
+    goertzelPass<2>(harmonicCoeff, block, count, harmonicPower);
+  } else {
+    goertzelPass<1>(&harmonicCoeff[1], block, count, &harmonicPower[1]);
+  }
+  float reject = dbToPower(DTMF_HARMONIC_REJECT_DB);
+  if (checkRow && (float)harmonicPower[0] * reject > rowPower * det.harmonicGain[row]) return 0;
+  if ((float)harmonicPower[1] * reject > colPower * det.harmonicGain[col]) return 0;
+
+  return DTMF_CHARS[row][col - 4];
+}
+
+// Apply the on/off duration rules to one block's result
+static bool dtmfUpdate(DtmfDetector& det, char hit, uint32_t blockStart, DtmfDigit& out) {
+  // A tone that only part-fills a block still passes every check in it, so
+  // two blocks at the edges of a 20ms burst could make a digit. Blocks of a
+  // real digit are full and match in level; a jump starts the count over.
+  float steady = dbToPower(DTMF_STEADY_DB);
+  bool level = det.blockPower < det.candidatePower * steady && det.candidatePower < det.blockPower * steady;
+  if (hit && hit == det.candidate && level) {
+    det.candidateBlocks++;
+  } else {
+    det.candidate = hit;
+    det.candidateBlocks = hit ? 1 : 0;
+    det.candidateStart = blockStart;
+  }
+  det.candidatePower = det.blockPower;
+
+  if (det.active) {
+    if (hit == det.active) {
+      det.offBlocks = 0;
+      return false;
+    }
+    if (++det.offBlocks < DTMF_MIN_OFF_BLOCKS) return false;
+    det.active = 0;
+  }
+
+  if (det.candidate && det.candidateBlocks >= DTMF_MIN_ON_BLOCKS) {
+    det.active = det.candidate;
+    det.offBlocks = 0;
+    out.digit = det.candidate;
+    out.onsetSample = det.candidateStart * det.decimation;
+    out.detectSample = det.position * det.decimation;
+    return true;
+  }
+  return false;
+}
+
+// Run detector-rate samples through the Goertzel blocks
+static int dtmfBlocks(DtmfDetector& det, const int16_t* samples, int count, DtmfDigit* digits, int maxDigits) {
+  int found = 0;
+  while (count > 0) {
+    int n = min(count, det.blockSize - det.fill);
+    memcpy(&det.block[det.fill], samples, n * sizeof(int16_t));
+    det.fill += n;
+    det.position += n;
+    samples += n;
+    count -= n;
+    if (det.fill < det.blockSize) break;
+
+    det.fill = 0;
+    uint32_t blockStart = det.position - det.blockSize;
+    char hit = dtmfClassifyBlock(det, det.block, det.blockSize);
+    DtmfDigit digit;
+    if (dtmfUpdate(det, hit, blockStart, digit) && found < maxDigits) {
+      digits[found++] = digit;
+    }
+  }
+  return found;
+}
+
+// Feed input-rate samples; returns how many digits started (at most maxDigits)
+int dtmfProcess(DtmfDetector& det, const int16_t* samples, int count, DtmfDigit* digits, int maxDigits) {
+  if (det.decimation <= 1) return dtmfBlocks(det, samples, count, digits, maxDigits);
+
+  int16_t reduced[128];
+  int found = 0;
+  while (count > 0) {
+    int n = min(count, 128 * det.decimation);
+    int produced = decimate(det.decimator, samples, n, reduced);
+    found += dtmfBlocks(det, reduced, produced, digits + found, maxDigits - found);
+    samples += n;
+    count -= n;
+  }
+  return found;
+}
+
+// ==================== Sequences ====================
+
+void dtmfSequenceReset(DtmfSequence& seq) {
+  seq.digits[0] = 0;
+  seq.length = 0;
+  seq.lastOnset = 0;
+  seq.complete = false;
+}
+
+// Returns true when this digit completes the sequence
+bool dtmfSequenceAdd(DtmfSequence& seq, const DtmfDigit& digit) {
+  if (seq.complete) return false;
+  if (seq.length < DTMF_MAX_DIGITS) {
+    seq.digits[seq.length++] = digit.digit;
+    seq.digits[seq.length] = 0;
+  }
+  seq.lastOnset = digit.onsetSample;
+  if (digit.digit == '#' || seq.length >= DTMF_MAX_DIGITS) {
+    seq.complete = true;
+  }
+  return seq.complete;
+}
+
+// Returns true if the gap since the last digit has just completed the sequence
+bool dtmfSequenceCheckTimeout(DtmfSequence& seq, uint32_t position, float sampleRate) {
+  if (seq.complete || seq.length == 0) return false;
+  uint32_t timeout = (uint32_t)(sampleRate * DTMF_DIGIT_TIMEOUT_MS / 1000);
+  if (position - seq.lastOnset < timeout) return false;
+  seq.complete = true;
+  return true;
+}
+
+// End of the recording: whatever was keyed so far is the sequence
+bool dtmfSequenceFinish(DtmfSequence& seq) {
+  if (seq.length > 0) seq.complete = true;
+  return seq.complete;
+}
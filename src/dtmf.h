@@ -0,0 +1,70 @@
+#ifndef DTMF_H
+#define DTMF_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "dsp.h"
+
+// Streaming DTMF decoder. Every sample goes through exactly one Goertzel
+// block; a block only counts as a digit if it passes the energy, twist,
+// relative-peak and second-harmonic checks, and a digit is only reported
+// once it has held at a steady level for DTMF_MIN_ON_BLOCKS (and is only
+// reported again after DTMF_MIN_OFF_BLOCKS without it).
+
+// The detector runs at SAMPLE_RATE, or in low-rate mode the input is
+// lowpassed and decimated first and the Goertzel blocks run at
+// SAMPLE_RATE / DTMF_DECIMATION. Both rates have their coefficient tables
+// built at compile time.
+
+// DTMF tones (tenths of a Hz): four rows, then four columns
+template <long SampleRate>
+using DtmfTones = ToneBank<SampleRate, 6970, 7700, 8520, 9410, 12090, 13360, 14770, 16330>;
+
+struct DtmfDigit {
+  char digit;
+  uint32_t onsetSample;  // First input sample of the first block it was heard in
+  uint32_t detectSample; // Input sample just past the block that confirmed it
+};
+
+struct DtmfDetector {
+  const int32_t* coeff;          // The eight DTMF tones, Q30, for the detector rate
+  const int32_t* harmonicCoeff;  // Their 2nd harmonics (candidate pair only)
+  float harmonicGain[8];         // Undoes the decimation lowpass's droop at 2f
+  float sampleRate;              // Detector rate (after decimation)
+  int decimation;
+  Decimator decimator;
+  int blockSize;
+  int16_t block[DTMF_BLOCK_SIZE];
+  int fill;
+  uint32_t position;             // Detector-rate samples fed so far
+  float blockPower;              // Row + column power of the last block classified
+  char candidate;                // Digit seen in the latest blocks
+  float candidatePower;          // Its level in the previous block
+  int candidateBlocks;
+  uint32_t candidateStart;
+  char active;                   // Digit reported and still held (0 = none)
+  int offBlocks;
+};
+
+void dtmfInit(DtmfDetector& det, int blockSize, bool lowRate);
+void dtmfReset(DtmfDetector& det);
+int dtmfProcess(DtmfDetector& det, const int16_t* samples, int count, DtmfDigit* digits, int maxDigits);
+char dtmfClassifyBlock(DtmfDetector& det, const int16_t* block, int count);
+
+// Digits grouped into a command: a sequence ends on '#' (which is kept, so
+// a lone "#" is still a command of its own), on DTMF_DIGIT_TIMEOUT_MS
+// without a new digit, or when the recording ends. The first complete
+// sequence wins; later digits are ignored.
+struct DtmfSequence {
+  char digits[DTMF_MAX_DIGITS + 1];
+  int length;
+  uint32_t lastOnset;  // Sample the latest digit started at
+  bool complete;
+};
+
+void dtmfSequenceReset(DtmfSequence& seq);
+bool dtmfSequenceAdd(DtmfSequence& seq, const DtmfDigit& digit);
+bool dtmfSequenceCheckTimeout(DtmfSequence& seq, uint32_t position, float sampleRate);
+bool dtmfSequenceFinish(DtmfSequence& seq);
+
+#endif // DTMF_H
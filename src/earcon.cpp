@@ -0,0 +1,70 @@
+#include "earcon.h"
+#include "dsp.h"
+#include "tts.h"
+
+struct EarconNote {
+  int hz;             // 0 = a gap
+  int ms;
+};
+
+#define EARCON_MAX_NOTES 5
+
+struct EarconPattern {
+  const char* name;
+  EarconNote notes[EARCON_MAX_NOTES];  // Ends at the first 0 ms note
+};
+
+static const EarconPattern EARCON_PATTERNS[EARCON_COUNT] = {
+  {"excellent", {{1200, 200}}},
+  {"good",      {{1000, 200}, {0, 100}, {1000, 200}}},
+  {"fair",      {{800, 200}, {0, 100}, {800, 200}, {0, 100}, {800, 200}}},
+  {"weak",      {{400, 500}}},
+  {"no signal", {{300, 300}, {0, 100}, {300, 300}}},
+};
+
+static int16_t* earconPcm[EARCON_COUNT];
+static int earconSamples[EARCON_COUNT];
+
+static int noteSamples(const EarconNote& note) {
+  return (int)((int64_t)SAMPLE_RATE * note.ms / 1000);
+}
+
+void initEarcons() {
+  int amplitude = (32767 * toneVolumePercent) / 100;
+  size_t bytes = 0;
+  for (int e = 0; e < EARCON_COUNT; e++) {
+    const EarconPattern& pattern = EARCON_PATTERNS[e];
+    int total = 0;
+    for (int n = 0; n < EARCON_MAX_NOTES && pattern.notes[n].ms > 0; n++) {
+      total += noteSamples(pattern.notes[n]);
+    }
+
+    earconPcm[e] = (int16_t*)ps_malloc(total * sizeof(int16_t));
+    if (!earconPcm[e]) {
+      Serial.printf("ERROR: No memory for the %s earcon\n", pattern.name);
+      earconSamples[e] = 0;
+      continue;
+    }
+    int16_t* out = earconPcm[e];
+    for (int n = 0; n < EARCON_MAX_NOTES && pattern.notes[n].ms > 0; n++) {
+      const EarconNote& note = pattern.notes[n];
+      int count = noteSamples(note);
+      if (note.hz == 0) {
+        memset(out, 0, count * sizeof(int16_t));
+      } else {
+        ToneOsc osc;
+        toneStart(osc, note.hz, amplitude, count, SAMPLE_RATE * TONE_RAMP_MS / 1000, SAMPLE_RATE);
+        toneRender(osc, out, count);
+      }
+      out += count;
+    }
+    earconSamples[e] = total;
+    bytes += total * sizeof(int16_t);
+  }
+  Serial.printf("Earcons: %d rendered, %u bytes PSRAM\n", EARCON_COUNT, (unsigned)bytes);
+}
+
+void playEarcon(int earcon) {
+  if (earcon < 0 || earcon >= EARCON_COUNT || !earconPcm[earcon]) return;
+  i2sWrite(earconPcm[earcon], earconSamples[earcon]);
+}
@@ -0,0 +1,25 @@
+#ifndef EARCON_H
+#define EARCON_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Feedback earcons: short tone patterns ahead of the spoken signal report.
+// Each is described as notes below, rendered once at boot (at the tone
+// volume, which only changes with a reboot) into PSRAM, and streamed to I2S
+// from there in one piece - gaps included - so nothing is computed, and
+// nothing waits on a delay(), while the radio is keyed.
+
+enum Earcon : uint8_t {
+  EARCON_EXCELLENT,
+  EARCON_GOOD,
+  EARCON_FAIR,
+  EARCON_WEAK,
+  EARCON_NO_SIGNAL,
+  EARCON_COUNT
+};
+
+void initEarcons();
+void playEarcon(int earcon);
+
+#endif // EARCON_H
@@ -0,0 +1,89 @@
+#include "fsk.h"
+#include "dsp.h"
+
+// One sine cycle, Q15 (dsp.h); the NCOs index it with the top 8 bits of their phase
+static const int16_t* sine = nullptr;
+
+void fskInit(FskDemod& fsk, float tone0Hz, float tone1Hz, float baud, float sampleRate) {
+  sine = sineTable();
+  fsk.toneStep[0] = (uint32_t)(4294967296.0 * tone0Hz / sampleRate);
+  fsk.toneStep[1] = (uint32_t)(4294967296.0 * tone1Hz / sampleRate);
+  fsk.bitStep = (uint32_t)(4294967296.0 * baud / sampleRate);
+  fsk.bitSamples = constrain((int)lroundf(sampleRate / baud), 1, FSK_MAX_BIT_SAMPLES);
+  fskReset(fsk);
+}
+
+void fskReset(FskDemod& fsk) {
+  memset(fsk.products, 0, sizeof(fsk.products));
+  memset(fsk.sums, 0, sizeof(fsk.sums));
+  fsk.tonePhase[0] = 0;
+  fsk.tonePhase[1] = 0;
+  fsk.pos = 0;
+  for (int p = 0; p < FSK_PHASES; p++) {
+    fsk.bitPhase[p] = (uint32_t)(0x100000000ULL * p / FSK_PHASES);
+  }
+  fsk.tone = false;
+}
+
+int fskDemodulate(FskDemod& fsk, const int16_t* samples, int count, uint8_t* bits, int maxBits) {
+  int found = 0;
+  for (int i = 0; i < count; i++) {
+    int32_t x = samples[i];
+
+    // Mix with both tones and slide the one-bit sums along
+    int32_t mixed[4];
+    for (int t = 0; t < 2; t++) {
+      uint8_t index = fsk.tonePhase[t] >> 24;
+      mixed[2 * t] = (x * sine[index]) >> 15;
+      mixed[2 * t + 1] = (x * sine[(uint8_t)(index + 64)]) >> 15;
+      fsk.tonePhase[t] += fsk.toneStep[t];
+    }
+    for (int k = 0; k < 4; k++) {
+      fsk.sums[k] += mixed[k] - fsk.products[k][fsk.pos];
+      fsk.products[k][fsk.pos] = mixed[k];
+    }
+    if (++fsk.pos >= fsk.bitSamples) fsk.pos = 0;
+
+    int64_t energy0 = (int64_t)fsk.sums[0] * fsk.sums[0] + (int64_t)fsk.sums[1] * fsk.sums[1];
+    int64_t energy1 = (int64_t)fsk.sums[2] * fsk.sums[2] + (int64_t)fsk.sums[3] * fsk.sums[3];
+    bool tone = energy1 > energy0;
+
+    // The sums flip half a bit into a new tone, half a bit before the
+    // read-off should be: pull each clock a quarter of the way onto that
+    bool flipped = tone != fsk.tone;
+    fsk.tone = tone;
+    for (int p = 0; p < FSK_PHASES; p++) {
+      if (flipped) fsk.bitPhase[p] -= (int32_t)(fsk.bitPhase[p] - 0x80000000u) / 4;
+      uint32_t previous = fsk.bitPhase[p];
+      fsk.bitPhase[p] += fsk.bitStep;
+      if (fsk.bitPhase[p] < previous && found < maxBits) {
+        bits[found++] = p * 2 + (tone ? 1 : 0);
+      }
+    }
+  }
+  return found;
+}
+
+// ==================== Modulator ====================
+
+void fskModulatorInit(FskModulator& mod, float tone0Hz, float tone1Hz, float baud, float sampleRate, int16_t amplitude) {
+  sine = sineTable();
+  mod.toneStep[0] = (uint32_t)(4294967296.0 * tone0Hz / sampleRate);
+  mod.toneStep[1] = (uint32_t)(4294967296.0 * tone1Hz / sampleRate);
+  mod.bitStep = (uint32_t)(4294967296.0 * baud / sampleRate);
+  mod.tonePhase = 0;
+  mod.bitPhase = 0;
+  mod.amplitude = amplitude;
+}
+
+// One bit's worth of samples: up to where the bit clock wraps
+int fskModulateBit(FskModulator& mod, int tone, int16_t* out) {
+  uint32_t step = mod.toneStep[tone ? 1 : 0];
+  int count = 0;
+  do {
+    out[count++] = (int16_t)((mod.amplitude * sine[mod.tonePhase >> 24]) >> 15);
+    mod.tonePhase += step;
+    mod.bitPhase += mod.bitStep;
+  } while (mod.bitPhase >= mod.bitStep && count < FSK_MAX_BIT_SAMPLES);
+  return count;
+}
@@ -0,0 +1,50 @@
+#ifndef FSK_H
+#define FSK_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Two-tone FSK modem for the data bursts radios send (MDC1200, AFSK1200).
+//
+// Demodulator: at every sample, sliding correlators one bit long against both
+// tones say which of them the last bit's worth of audio is closer to.
+// FSK_PHASES bit clocks start staggered across the bit, each one pulled
+// onto the tone changes it sees (they belong on its bit edges) and reading
+// its bits off mid-bit. The framing layer keeps one decoder per clock and
+// takes whichever finds a valid frame: the clock that started closest has
+// the burst from its first bit, and the others catch up within a few.
+
+#define FSK_PHASES 4
+#define FSK_MAX_BIT_SAMPLES 32  // Correlator length: SAMPLE_RATE / baud, rounded
+
+struct FskDemod {
+  uint32_t toneStep[2];   // NCO step per sample, 2^32 = one cycle
+  uint32_t tonePhase[2];
+  int bitSamples;
+  int32_t products[4][FSK_MAX_BIT_SAMPLES];  // Tone 0 I/Q, tone 1 I/Q
+  int32_t sums[4];
+  int pos;
+  uint32_t bitStep;       // Bit clock step, 2^32 = one bit
+  uint32_t bitPhase[FSK_PHASES];  // Bits are read off as these wrap
+  bool tone;              // Tone 1 stronger at the last sample
+};
+
+void fskInit(FskDemod& fsk, float tone0Hz, float tone1Hz, float baud, float sampleRate);
+void fskReset(FskDemod& fsk);
+// Returns how many bits were read off (at most maxBits). Each is the clock
+// that read it (0 to FSK_PHASES - 1) times 2, plus 1 if it was tone 1.
+int fskDemodulate(FskDemod& fsk, const int16_t* samples, int count, uint8_t* bits, int maxBits);
+
+// Modulator: phase-continuous, straight from the same sine table
+struct FskModulator {
+  uint32_t toneStep[2];
+  uint32_t tonePhase;
+  uint32_t bitStep;
+  uint32_t bitPhase;
+  int16_t amplitude;
+};
+
+void fskModulatorInit(FskModulator& mod, float tone0Hz, float tone1Hz, float baud, float sampleRate, int16_t amplitude);
+int fskModulateBit(FskModulator& mod, int tone, int16_t* out);  // Returns samples written, at most FSK_MAX_BIT_SAMPLES
+
+#endif // FSK_H
@@ -0,0 +1,153 @@
+#include "mdc.h"
+
+#define MDC_SYNC_MASK 0xFFFFFFFFFFULL
+
+// CRC-16 of the first four bytes: CCITT polynomial, fed LSB first from
+// zero, then bit-reversed and inverted
+static uint16_t mdcCrc(const uint8_t* data, int count) {
+  uint16_t crc = 0;
+  for (int i = 0; i < count; i++) {
+    for (int b = 0; b < 8; b++) {
+      bool feedback = ((crc >> 15) ^ (data[i] >> b)) & 1;
+      crc <<= 1;
+      if (feedback) crc ^= 0x1021;
+    }
+  }
+  uint16_t reversed = 0;
+  for (int b = 0; b < 16; b++) {
+    if (crc & (1 << b)) reversed |= 0x8000 >> b;
+  }
+  return reversed ^ 0xFFFF;
+}
+
+// Bit n of the 56 data bits (bytes 0-6, LSB first) and of their parity (bytes 7-13)
+static inline int mdcBit(const uint8_t* data, int n) {
+  return (data[n / 8] >> (n % 8)) & 1;
+}
+
+// Coded bit n goes out at this position (interleaved 16 deep)
+static inline int mdcInterleave(int n) {
+  return (n % 7) * 16 + n / 7;
+}
+
+// Parity bit n = data bits n, n - 2, n - 5 and n - 6
+static inline int mdcParity(uint8_t history) {
+  return (history ^ (history >> 2) ^ (history >> 5) ^ (history >> 6)) & 1;
+}
+
+// Majority-logic decoding: a wrong data bit flips the syndromes of its own
+// parity bit and of the ones 2, 5 and 6 bits later, so once three of those
+// four are set the bit 7 back gets flipped (and its syndromes cleared)
+static void mdcCorrect(uint8_t* data) {
+  uint8_t history = 0;  // Last 7 data bits, newest in bit 0
+  uint8_t syndrome = 0;
+  for (int n = 0; n < 56; n++) {
+    history = (history << 1) | mdcBit(data, n);
+    syndrome = (syndrome << 1) | (mdcParity(history) ^ mdcBit(data, 56 + n));
+    int votes = ((syndrome >> 7) & 1) + ((syndrome >> 5) & 1) + ((syndrome >> 2) & 1) + ((syndrome >> 1) & 1);
+    if (votes >= 3 && n >= 7) {
+      syndrome ^= 0xA6;
+      data[(n - 7) / 8] ^= 1 << ((n - 7) % 8);
+    }
+  }
+}
+
+int mdcEncode(const MdcFrame& frame, uint8_t* bits) {
+  uint8_t data[14] = {frame.op, frame.arg, (uint8_t)(frame.unit >> 8), (uint8_t)frame.unit};
+  uint16_t crc = mdcCrc(data, 4);
+  data[4] = crc & 0xFF;
+  data[5] = crc >> 8;
+  uint8_t history = 0;
+  for (int n = 0; n < 56; n++) {
+    history = (history << 1) | mdcBit(data, n);
+    data[7 + n / 8] |= mdcParity(history) << (n % 8);
+  }
+
+  int count = 0;
+  for (int i = 0; i < MDC_PREAMBLE_BITS; i++) {
+    bits[count++] = i & 1;  // 0x55...
+  }
+  for (int i = 39; i >= 0; i--) {
+    bits[count++] = (MDC_SYNC >> i) & 1;
+  }
+  for (int n = 0; n < MDC_FRAME_BITS; n++) {
+    bits[count + mdcInterleave(n)] = mdcBit(data, n);
+  }
+  return count + MDC_FRAME_BITS;
+}
+
+void mdcInit(MdcDecoder& dec, float sampleRate) {
+  fskInit(dec.fsk, MDC_TONE_LOW_HZ, MDC_TONE_HIGH_HZ, MDC_BAUD, sampleRate);
+  mdcReset(dec);
+}
+
+static void mdcHunt(MdcDecoder& dec) {
+  for (int p = 0; p < FSK_PHASES; p++) {
+    dec.lanes[p].shift = 0;
+    dec.lanes[p].bits = -1;
+  }
+}
+
+void mdcReset(MdcDecoder& dec) {
+  fskReset(dec.fsk);
+  for (int p = 0; p < FSK_PHASES; p++) {
+    dec.lanes[p].level = false;
+  }
+  mdcHunt(dec);
+  dec.frames = 0;
+  memset(&dec.last, 0, sizeof(dec.last));
+}
+
+// A complete frame: undo the interleaving, fix what can be fixed, check the CRC
+static bool mdcDecodeFrame(const uint8_t* bits, MdcFrame& frame) {
+  uint8_t data[14] = {};
+  for (int n = 0; n < MDC_FRAME_BITS; n++) {
+    data[n / 8] |= bits[mdcInterleave(n)] << (n % 8);
+  }
+  mdcCorrect(data);
+  if (mdcCrc(data, 4) != (data[4] | (data[5] << 8))) return false;
+  frame.op = data[0];
+  frame.arg = data[1];
+  frame.unit = (data[2] << 8) | data[3];
+  return true;
+}
+
+// One bit (1 = 1800Hz) on one lane; true if it completed a valid frame
+static bool mdcLaneBit(MdcLane& lane, int tone, MdcFrame& frame) {
+  lane.level ^= tone;
+  if (lane.bits < 0) {
+    lane.shift = ((lane.shift << 1) | lane.level) & MDC_SYNC_MASK;
+    if (lane.shift == MDC_SYNC || lane.shift == (~MDC_SYNC & MDC_SYNC_MASK)) {
+      lane.inverted = lane.shift != MDC_SYNC;
+      lane.bits = 0;
+    }
+    return false;
+  }
+
+  lane.frame[lane.bits++] = lane.level ^ lane.inverted;
+  if (lane.bits < MDC_FRAME_BITS) return false;
+  lane.bits = -1;
+  return mdcDecodeFrame(lane.frame, frame);
+}
+
+// Feed audio at the rate given to mdcInit
+bool mdcProcess(MdcDecoder& dec, const int16_t* samples, int count) {
+  bool decoded = false;
+  while (count > 0) {
+    int n = min(count, 64);
+    uint8_t bits[64 * FSK_PHASES / 8 + FSK_PHASES];
+    int found = fskDemodulate(dec.fsk, samples, n, bits, sizeof(bits));
+    for (int i = 0; i < found; i++) {
+      MdcFrame frame;
+      if (!mdcLaneBit(dec.lanes[bits[i] / 2], bits[i] & 1, frame)) continue;
+      // The neighbouring lanes are reading the same burst: start them all over
+      dec.last = frame;
+      dec.frames++;
+      decoded = true;
+      mdcHunt(dec);
+    }
+    samples += n;
+    count -= n;
+  }
+  return decoded;
+}
@@ -0,0 +1,48 @@
+#ifndef MDC_H
+#define MDC_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fsk.h"
+
+// MDC1200 decoder: the ANI burst many commercial radios send on key-up,
+// carrying the radio's 16-bit unit ID. 1200 baud on 1200/1800Hz, NRZI
+// (1800Hz means the bit changed from the last one). A preamble and the
+// 40-bit sync word are followed by 112 bits: 7 bytes (opcode, argument,
+// unit ID, CRC, status) plus their rate-1/2 convolutional parity,
+// interleaved 16 deep. Single errors inside the code's window are fixed;
+// only frames whose CRC then checks out are reported.
+
+#define MDC_SYNC 0x07092A446FULL
+#define MDC_PREAMBLE_BITS 56
+#define MDC_FRAME_BITS 112
+#define MDC_BURST_BITS (MDC_PREAMBLE_BITS + 40 + MDC_FRAME_BITS)
+
+struct MdcFrame {
+  uint8_t op;
+  uint8_t arg;
+  uint16_t unit;
+};
+
+// One per FSK bit clock
+struct MdcLane {
+  uint64_t shift;     // Last 40 bits, for the sync word
+  bool level;         // NRZI state
+  bool inverted;      // The sync word came in upside down
+  int bits;           // Frame bits collected, -1 = hunting for the sync word
+  uint8_t frame[MDC_FRAME_BITS];
+};
+
+struct MdcDecoder {
+  FskDemod fsk;
+  MdcLane lanes[FSK_PHASES];
+  int frames;         // Valid frames decoded since the reset
+  MdcFrame last;
+};
+
+void mdcInit(MdcDecoder& dec, float sampleRate);
+void mdcReset(MdcDecoder& dec);
+bool mdcProcess(MdcDecoder& dec, const int16_t* samples, int count);  // True if a frame was decoded
+int mdcEncode(const MdcFrame& frame, uint8_t* bits);  // MDC_BURST_BITS bits, one per byte, before NRZI
+
+#endif // MDC_H
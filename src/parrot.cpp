@@ -7,7 +7,13 @@
 #include "tts.h"
 #include "weather.h"
 #include "radio.h"
+#include "capture.h"
+#include "slots.h"
+#include "dsp.h"
+#include "bench.h"
 #include "web.h"
+#include "tx.h"
+#include "earcon.h"
 
 // ==================== Global State Definitions ====================
 // (declared extern in config.h)
@@ -31,6 +37,7 @@ int radioSquelch;
 // Audio settings
 int samVolumePercent;
 int toneVolumePercent;
+int prerollMs;
 
 // Pin configuration (runtime)
 int pinPTT;
@@ -63,8 +70,15 @@ float lastBatteryV = 0;
 int lastBatteryPct = -1;
 
 // Recording buffers
-int16_t* audioBuffer = nullptr;
+int maxRecordSeconds = MAX_RECORDING_SECONDS;
 int recordIndex = 0;
+int recordPreroll = 0;
+int recordTrimStart = 0;
+int recordTrimEnd = 0;
+bool vadTrimEnabled = true;
+bool filterDcBlock = true;
+bool filterHighpass = true;
+bool filterDeemphasis = false;
 bool recording = false;
 
 // Signal quality tracking
@@ -76,9 +90,27 @@ int clipCount = 0;
 // Recording slots
 RecordingSlot slots[MAX_SLOTS];
 int nextSlot = 0;
+int slotEvictPolicy = EVICT_OLDEST;
+bool slotCompression = true;
+int storageDecimation = STORAGE_DECIMATION_DEFAULT;
 
-// DTMF detection
-char detectedDTMF = 0;
+// DTMF command from the last recording
+char dtmfCommand[DTMF_MAX_DIGITS + 1] = "";
+String dtmfAdminPin;
+bool dtmfLowRate = false;
+
+// CTCSS tone / DCS code of the last recording
+bool ctcssDecode = false;
+int callerCtcss = -1;
+int callerDcs = -1;
+int callerDcsTwin = -1;
+
+// MDC1200 unit ID of the last recording
+int callerUnit = -1;
+
+// AX.25 telemetry beacon
+String beaconCallsign;
+int beaconIntervalMin = 0;
 
 // ==================== Hardware Objects ====================
 
@@ -128,36 +160,40 @@ void setup() {
                 pinI2S_MCLK, pinI2S_BCLK, pinI2S_LRCLK, pinI2S_DIN, pinI2S_DOUT);
   Serial.printf("Testing mode: %s\n", testingMode ? "ON" : "OFF");
 
-  // Allocate audio buffer in PSRAM
-  if (psramFound()) {
-    audioBuffer = (int16_t*)ps_malloc(MAX_SAMPLES * sizeof(int16_t));
-    Serial.printf("PSRAM: %d bytes free, audio buffer allocated\n", ESP.getFreePsram());
-
-    // Initialize recording slots
-    initSlots();
-
-    // Initialize Goertzel coefficients for DTMF detection
-    initGoertzel();
-  } else {
-    audioBuffer = (int16_t*)malloc(MAX_SAMPLES * sizeof(int16_t));
-    Serial.println("Warning: PSRAM not found, using internal RAM (no DTMF mailbox)");
+  // Recordings and the recording slots live in a PSRAM arena
+  if (!psramFound()) {
+    Serial.println("ERROR: PSRAM not found, nowhere to record!");
+    while (1) delay(1000);
   }
-
-  if (!audioBuffer) {
-    Serial.println("ERROR: Failed to allocate audio buffer!");
+  Serial.printf("PSRAM: %d bytes free\n", ESP.getFreePsram());
+  initEarcons();  // Ahead of the arena, which takes what is left
+  if (!initSlots()) {
     while (1) delay(1000);
   }
 
-  // Initialize I2S
+  // Initialize the DTMF, CTCSS, DCS, MDC1200 and AX.25 decoders
+  initDTMF();
+  initToneDecoders();
+  initResampler();
+
+  // Initialize I2S, the capture task draining it and the record task draining that
   initI2S();
+  initCapture();
+  initRecorder();
+  initSquelch();
 
   // Initialize SA868
   delay(500);
   while (SA868.available()) SA868.read();  // Clear receive buffer
   initializeSA868();
 
-  // Initialize eSpeak NG speech synthesis
+  // Initialize eSpeak NG speech synthesis, and the TX task that runs it
   initTTS();
+  initTx();
+
+#ifdef PARROT_BENCH
+  runBenchmarks();
+#endif
 
   // Ignore squelch pin for 5 seconds after boot (RF noise during startup)
   wifiReadyTime = max(wifiReadyTime, millis() + 5000);
@@ -165,6 +201,112 @@ void setup() {
   Serial.println("Ready for radio checks!");
 }
 
+// ==================== DTMF Commands ====================
+
+// Key up and say something short
+static void announce(const char* text) {
+  TxJob* job = txNewJob("announce", REPLY_WAIT_MS, 600, 1000);
+  txSpeech(job, text);
+  txSubmit(job);
+}
+
+// D<pin>*<code>[slot]: 1 = clear unpinned recordings, 2<n> = pin slot n,
+// 3<n> = unpin slot n, 9 = reboot. Disabled while no admin PIN is set.
+static bool runAdminCommand(const char* command) {
+  const char* star = strchr(command, '*');
+  if (dtmfAdminPin.length() == 0 || !star) return false;
+  if (dtmfAdminPin != String(command).substring(0, star - command)) {
+    Serial.println("DTMF admin: wrong PIN");
+    announce("access denied");
+    return true;
+  }
+
+  const char* code = star + 1;
+  int slot = atoi(code + 1);
+  switch (code[0]) {
+    case '1':
+      for (int i = 0; i < MAX_SLOTS; i++) {
+        if (!slots[i].pinned) clearSlot(i);
+      }
+      announce("recordings cleared");
+      break;
+    case '2':
+    case '3':
+      if (slot < 1 || slot > MAX_SLOTS || slots[slot - 1].sampleCount == 0) {
+        announce("no such recording");
+        break;
+      }
+      setSlotPinned(slot - 1, code[0] == '2');
+      announce(code[0] == '2' ? "recording pinned" : "recording unpinned");
+      break;
+    case '9':
+      announce("rebooting");
+      while (txBusy()) delay(10);
+      ESP.restart();
+      break;
+    default:
+      announce("unknown command");
+      break;
+  }
+  return true;
+}
+
+// Returns false if the sequence isn't a command
+static bool runDtmfCommand(const char* command) {
+  char seq[DTMF_MAX_DIGITS + 1];
+  strcpy(seq, command);
+  int len = strlen(seq);
+  if (len == 0) return false;
+  if (len > 1 && seq[len - 1] == '#') seq[--len] = 0;  // Terminator
+
+  if (strcmp(seq, "#") == 0) {
+    // DTMF # - speak configurable message with macro expansion
+    if (dtmfHashMessage.length() == 0) return false;
+    String expanded = expandMacros(dtmfHashMessage);
+    announce(expanded.c_str());
+    return true;
+  }
+  if (strcmp(seq, "*") == 0) {
+    // DTMF * - speak weather (handles PTT and speech internally)
+    speakWeather();
+    return true;
+  }
+  if (strcmp(seq, "9") == 0) {
+    // DTMF 9 - play embedded radio test audio
+    playRadioTest();
+    return true;
+  }
+  if (seq[0] == 'D') {
+    return runAdminCommand(seq + 1);
+  }
+
+  // Slot numbers: 1-8 on their own, 09 and 10-64 as two digits
+  if (len <= 2 && isdigit(seq[0]) && (len == 1 || isdigit(seq[1]))) {
+    int slot = atoi(seq);
+    if (slot >= 1 && slot <= MAX_SLOTS) {
+      playSlot(slot - 1);
+      return true;
+    }
+  }
+
+  Serial.printf("Unknown DTMF command: %s\n", command);
+  return false;
+}
+
+// A recording has finished: run the DTMF command it carried, or parrot it.
+// Anything that carried DTMF digits is a command, known or not, and is
+// never saved or played back (squelch pops with a stray digit included).
+static void handleRecording() {
+  if (dtmfCommand[0] != 0) {
+    if (!runDtmfCommand(dtmfCommand)) {
+      Serial.println("Dropping the recording, it carried DTMF digits");
+    }
+    return;
+  }
+  // Normal parrot mode - save and playback
+  playbackWithFeedback(saveRecording());
+}
+
 // ==================== Main Loop ====================
 
 void loop() {
@@ -180,6 +322,10 @@ void loop() {
   static unsigned long recordStartTime = 0;
   static unsigned long lastRSSISample = 0;
 
+  // Half duplex: nothing is recorded while a reply is queued or on the air
+  // (wasReceiving stays as it was, like when replies blocked loop())
+  if (txBusy()) return;
+
   bool nowReceiving = isReceiving();
 
   // Track RSSI periodically during reception
@@ -196,85 +342,37 @@ void loop() {
     recordStartTime = millis();
   }
 
-  // Record audio samples via I2S
-  if (recording && nowReceiving) {
-    recordAudioSamples();
-  }
-
   // Detect end of transmission
   if (!nowReceiving && wasReceiving && recording) {
     stopRecording();
 
     // Ignore squelch pops and no-signal recordings
-    if (recordIndex < MIN_RECORDING_SAMPLES || peakAudioLevel < MIN_AUDIO_LEVEL) {
+    if (dtmfCommand[0] == 0 &&
+        (recordIndex - recordPreroll < MIN_RECORDING_SAMPLES || peakAudioLevel < MIN_AUDIO_LEVEL)) {
       Serial.printf("Ignoring short/empty recording (%d samples, peak=%.3f)\n",
                      recordIndex, peakAudioLevel);
       wasReceiving = nowReceiving;
       return;
     }
 
-    delay(2000);
-
-    if (detectedDTMF == '#' && dtmfHashMessage.length() > 0) {
-      // DTMF # - speak configurable message with macro expansion
-      String expanded = expandMacros(dtmfHashMessage);
-      pttOn();
-      delay(600);
-      sayText(expanded.c_str());
-      delay(1000);
-      pttOff();
-    } else if (detectedDTMF == '*') {
-      // DTMF * - speak weather (handles PTT and speech internally)
-      speakWeather();
-    } else if (detectedDTMF == '9') {
-      // DTMF 9 - play embedded radio test audio
-      playRadioTest();
-    } else if (detectedDTMF >= '1' && detectedDTMF <= '8') {
-      // DTMF 1-8 - play back requested slot
-      int slotIndex = detectedDTMF - '1';  // '1' -> slot 0, '8' -> slot 7
-      playSlot(slotIndex);
-    } else {
-      // Normal parrot mode - save and playback
-      saveToSlot(nextSlot);
-      nextSlot = (nextSlot + 1) % MAX_SLOTS;
-      playbackWithFeedback();
-    }
+    handleRecording();
   }
 
   // Timeout safety
-  if (recording && (millis() - recordStartTime > 10000)) {
+  if (recording && (millis() - recordStartTime > maxRecordSeconds * 1000UL)) {
     Serial.println("Recording timeout!");
     stopRecording();
 
     // Ignore squelch pops and no-signal recordings
-    if (recordIndex < MIN_RECORDING_SAMPLES || peakAudioLevel < MIN_AUDIO_LEVEL) {
+    if (dtmfCommand[0] == 0 &&
+        (recordIndex - recordPreroll < MIN_RECORDING_SAMPLES || peakAudioLevel < MIN_AUDIO_LEVEL)) {
       Serial.printf("Ignoring short/empty recording (%d samples, peak=%.3f)\n",
                      recordIndex, peakAudioLevel);
       wasReceiving = nowReceiving;
       return;
     }
 
-    delay(2000);
-
-    if (detectedDTMF == '#' && dtmfHashMessage.length() > 0) {
-      String expanded = expandMacros(dtmfHashMessage);
-      pttOn();
-      delay(600);
-      sayText(expanded.c_str());
-      delay(1000);
-      pttOff();
-    } else if (detectedDTMF == '*') {
-      speakWeather();
-    } else if (detectedDTMF == '9') {
-      playRadioTest();
-    } else if (detectedDTMF >= '1' && detectedDTMF <= '8') {
-      int slotIndex = detectedDTMF - '1';
-      playSlot(slotIndex);
-    } else {
-      saveToSlot(nextSlot);
-      nextSlot = (nextSlot + 1) % MAX_SLOTS;
-      playbackWithFeedback();
-    }
+    handleRecording();
   }
 
   // Battery voltage check (only when idle, disabled if pinVBAT == -1)
@@ -295,5 +393,13 @@ void loop() {
     }
   }
 
+  // Telemetry beacon (only when idle)
+  static unsigned long lastBeacon = 0;
+  if (beaconIntervalMin > 0 && beaconCallsign.length() > 0 && !recording && !nowReceiving &&
+      millis() - lastBeacon > beaconIntervalMin * 60000UL) {
+    lastBeacon = millis();
+    sendTelemetryBeacon();
+  }
+
   wasReceiving = nowReceiving;
 }
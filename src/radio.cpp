@@ -1,148 +1,107 @@
 #include "radio.h"
 #include "config.h"
 #include "tts.h"
+#include "capture.h"
+#include "slots.h"
+#include "dsp.h"
+#include "dtmf.h"
+#include "ctcss.h"
+#include "dcs.h"
+#include "mdc.h"
+#include "ax25.h"
+#include "tx.h"
+#include "earcon.h"
 #include <driver/i2s.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <radio_test_audio.h>
 
-// DTMF frequencies (Hz)
-static const float DTMF_FREQS[8] = {697, 770, 852, 941, 1209, 1336, 1477, 1633};
-// Row/column mapping to digits
-static const char DTMF_CHARS[4][4] = {
-  {'1', '2', '3', 'A'},
-  {'4', '5', '6', 'B'},
-  {'7', '8', '9', 'C'},
-  {'*', '0', '#', 'D'}
-};
-
-// Goertzel coefficients (precomputed for SAMPLE_RATE)
-static float goertzelCoeff[8];
-
-void initGoertzel() {
-  for (int i = 0; i < 8; i++) {
-    float k = (DTMF_BLOCK_SIZE * DTMF_FREQS[i]) / SAMPLE_RATE;
-    goertzelCoeff[i] = 2.0f * cos(2.0f * PI * k / DTMF_BLOCK_SIZE);
-  }
-}
-
-static float goertzelMagnitude(int16_t* samples, int count, int freqIndex) {
-  float s0 = 0, s1 = 0, s2 = 0;
-  float coeff = goertzelCoeff[freqIndex];
-
-  for (int i = 0; i < count; i++) {
-    s0 = samples[i] + coeff * s1 - s2;
-    s2 = s1;
-    s1 = s0;
-  }
-
-  // Magnitude squared
-  return s1 * s1 + s2 * s2 - coeff * s1 * s2;
-}
-
-char detectDTMF(int16_t* samples, int count) {
-  float magnitudes[8];
-  float maxRow = 0, maxCol = 0;
-  int rowIdx = -1, colIdx = -1;
-
-  // Calculate magnitudes for all 8 frequencies
-  for (int i = 0; i < 8; i++) {
-    magnitudes[i] = goertzelMagnitude(samples, count, i);
-  }
-
-  // Find strongest row frequency (0-3)
-  for (int i = 0; i < 4; i++) {
-    if (magnitudes[i] > maxRow) {
-      maxRow = magnitudes[i];
-      rowIdx = i;
-    }
-  }
-
-  // Find strongest column frequency (4-7)
-  for (int i = 4; i < 8; i++) {
-    if (magnitudes[i] > maxCol) {
-      maxCol = magnitudes[i];
-      colIdx = i - 4;
+// ==================== I2S Events ====================
+
+static QueueHandle_t i2sEventQueue = nullptr;
+I2sStats i2sStats = {};
+AirActivity lastRecording = {};
+AirActivity lastTransmission = {};
+
+// From the first i2sWrite() of a transmission until its last audio is
+// queued. The output DMA runs dry whenever nothing is being played (idle,
+// key-up and tail delays) and that is no underrun, so TX_Q_OVF only counts
+// in between.
+static volatile bool txStreaming = false;
+
+// Called by the capture task after every block, so events are timestamped
+// within one DMA buffer (~12ms) of happening. RX/TX_DONE arrive for every
+// buffer and are just discarded.
+void pollI2SEvents() {
+  if (!i2sEventQueue) return;
+  i2s_event_t event;
+  while (xQueueReceive(i2sEventQueue, &event, 0) == pdTRUE) {
+    switch (event.type) {
+      case I2S_EVENT_RX_Q_OVF:
+        i2sStats.rxOverflows++;
+        i2sStats.lastRxOverflowUs = esp_timer_get_time();
+        break;
+      case I2S_EVENT_TX_Q_OVF:
+        if (!txStreaming) break;
+        i2sStats.txUnderruns++;
+        i2sStats.lastTxUnderrunUs = esp_timer_get_time();
+        break;
+      case I2S_EVENT_DMA_ERROR:
+        i2sStats.dmaErrors++;
+        break;
+      default:
+        break;
     }
   }
-
-  // Need both row and column to be significantly above noise
-  // Threshold tuned for radio audio - increase if getting false positives
-  float threshold = 1e12;  // Adjust based on testing
-  if (maxRow > threshold && maxCol > threshold) {
-    // Check that the two strongest are much stronger than others
-    char digit = DTMF_CHARS[rowIdx][colIdx];
-    Serial.printf("DTMF detected: %c (row=%d col=%d mag=%.0f/%.0f)\n",
-                  digit, rowIdx, colIdx, maxRow, maxCol);
-    return digit;
-  }
-
-  return 0;
 }
 
-void initSlots() {
-  for (int i = 0; i < MAX_SLOTS; i++) {
-    slots[i].buffer = (int16_t*)ps_malloc(MAX_SAMPLES * sizeof(int16_t));
-    slots[i].sampleCount = 0;
-    if (!slots[i].buffer) {
-      Serial.printf("ERROR: Failed to allocate slot %d!\n", i + 1);
-    }
-  }
-  Serial.printf("Allocated %d recording slots in PSRAM\n", MAX_SLOTS);
-  Serial.printf("PSRAM remaining: %d bytes\n", ESP.getFreePsram());
+static void beginActivity(AirActivity& activity) {
+  activity.count++;
+  time_t now = time(nullptr);
+  activity.started = now > 1000000000 ? now : 0;  // Only if the clock is set
+  activity.startUs = esp_timer_get_time();
+  activity.endUs = 0;
+  activity.rxOverflows = 0;
+  activity.txUnderruns = 0;
+  activity.rxOverflowsBase = i2sStats.rxOverflows;
+  activity.txUnderrunsBase = i2sStats.txUnderruns;
 }
 
-void saveToSlot(int slotIndex) {
-  if (slotIndex < 0 || slotIndex >= MAX_SLOTS) return;
-  if (!slots[slotIndex].buffer) return;
-
-  // Copy current recording to slot
-  int copyCount = min(recordIndex, MAX_SAMPLES);
-  memcpy(slots[slotIndex].buffer, audioBuffer, copyCount * sizeof(int16_t));
-  slots[slotIndex].sampleCount = copyCount;
-  Serial.printf("Saved %d samples to slot %d\n", copyCount, slotIndex + 1);
+static void endActivity(AirActivity& activity, const char* name) {
+  activity.endUs = esp_timer_get_time();
+  activity.rxOverflows = i2sStats.rxOverflows - activity.rxOverflowsBase;
+  activity.txUnderruns = i2sStats.txUnderruns - activity.txUnderrunsBase;
+  Serial.printf("I2S during %s: %u RX overflows, %u TX underruns (%lld ms)\n", name,
+                activity.rxOverflows, activity.txUnderruns, (activity.endUs - activity.startUs) / 1000);
 }
 
 void pttOn() {
   if (!testingMode) {
     digitalWrite(pinPTT, LOW);
   }
+  beginActivity(lastTransmission);
   Serial.println(testingMode ? "PTT ON (disabled - testing mode)" : "PTT ON");
 }
 
 void pttOff() {
+  i2sStreamEnd();
   digitalWrite(pinPTT, HIGH);  // Always release PTT
   Serial.println("PTT OFF");
+  if (lastTransmission.startUs && !lastTransmission.endUs) {
+    endActivity(lastTransmission, "transmission");
+  }
 }
 
 void playSlot(int slotIndex) {
   if (slotIndex < 0 || slotIndex >= MAX_SLOTS) return;
 
-  // Key PTT first - need enough time for radio to key up
-  pttOn();
-  delay(600);
-
-  if (slots[slotIndex].sampleCount == 0 || !slots[slotIndex].buffer) {
-    Serial.printf("Slot %d is empty\n", slotIndex + 1);
-    sayText("no recording");
-  } else {
-    Serial.printf("Playing slot %d (%d samples)\n", slotIndex + 1, slots[slotIndex].sampleCount);
-
-    // Play back the slot
-    for (int i = 0; i < slots[slotIndex].sampleCount; i += 256) {
-      int chunkSize = min(256, slots[slotIndex].sampleCount - i);
-      i2sWrite(&slots[slotIndex].buffer[i], chunkSize);
-    }
-  }
-
-  delay(300);
-  pttOff();
+  // 600ms for the radio to key up
+  TxJob* job = txNewJob("slot", REPLY_WAIT_MS, 600, 300);
+  txSlot(job, slotIndex);
+  txSubmit(job);
 }
 
-void playRadioTest() {
-  // Key PTT first
-  pttOn();
-  delay(900);
-
+static void streamRadioTest() {
   Serial.printf("Playing radio test audio (%d samples, %.1f sec)\n",
                 RADIO_TEST_SAMPLES, (float)RADIO_TEST_SAMPLES / RADIO_TEST_SAMPLE_RATE);
 
@@ -156,12 +115,55 @@ void playRadioTest() {
     }
     i2sWrite(buffer, chunkSize);
   }
-
-  delay(300);
-  pttOff();
   Serial.println("Radio test complete!");
 }
 
+void playRadioTest() {
+  TxJob* job = txNewJob("radio test", REPLY_WAIT_MS, 900, 300);
+  txRender(job, streamRadioTest);
+  txSubmit(job);
+}
+
+// APRS telemetry as one AX.25 UI frame: battery %, volts x10, peak RSSI of
+// the last recording, slots used, uptime in hours, then testing mode / NTP
+// synced / RTC found as bits. Well under a second on the air, where the
+// same figures spoken take several. Built when it goes out.
+static void streamTelemetryBeacon() {
+  static int sequence = 0;
+  char info[48];
+  snprintf(info, sizeof(info), "T#%03d,%03d,%03d,%03d,%03d,%03d,%d%d%d00000", sequence,
+           max(lastBatteryPct, 0), constrain((int)lroundf(lastBatteryV * 10), 0, 255), constrain(peakRSSI, 0, 255),
+           usedSlotCount(), (int)min(millis() / 3600000UL, 255UL), testingMode, ntpSynced, rtcFound);
+  sequence = (sequence + 1) % 1000;
+
+  uint8_t frame[AX25_MAX_FRAME];
+  int length = ax25BuildUi(frame, BEACON_DEST, beaconCallsign.c_str(), BEACON_PATH, info);
+  if (length == 0) {
+    Serial.printf("Beacon: can't send from callsign '%s'\n", beaconCallsign.c_str());
+    return;
+  }
+
+  AfskEncoder encoder;
+  afskBegin(encoder, frame, length, AFSK_TXDELAY_FLAGS, AFSK_TAIL_FLAGS, (32767 * toneVolumePercent) / 100, SAMPLE_RATE);
+  int16_t buffer[256];
+  int chunkSize;
+  int total = 0;
+  while ((chunkSize = afskRender(encoder, buffer, 256)) > 0) {
+    i2sWrite(buffer, chunkSize);
+    total += chunkSize;
+  }
+
+  char text[AX25_MAX_FRAME + 80];
+  ax25Format(frame, length, text, sizeof(text));
+  Serial.printf("Beacon: %s (%d bytes, %d ms of AFSK)\n", text, length, total * 1000 / SAMPLE_RATE);
+}
+
+void sendTelemetryBeacon() {
+  TxJob* job = txNewJob("beacon", 0, 300, 300);
+  txRender(job, streamTelemetryBeacon);
+  txSubmit(job);
+}
+
 void initI2S() {
   i2s_config_t i2s_config = {
     .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX),
@@ -185,7 +187,7 @@ void initI2S() {
     .data_in_num = pinI2S_DIN
   };
 
-  esp_err_t err = i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
+  esp_err_t err = i2s_driver_install(I2S_PORT, &i2s_config, I2S_EVENT_QUEUE_LEN, &i2sEventQueue);
   if (err != ESP_OK) {
     Serial.printf("I2S driver install failed: %d\n", err);
     return;
@@ -201,9 +203,19 @@ void initI2S() {
   Serial.println("I2S initialized");
 }
 
-void i2sWrite(int16_t* data, size_t samples) {
+void i2sWrite(const int16_t* data, size_t samples) {
+  if (!txStreaming) {
+    // Underruns count from here, not from key-up
+    lastTransmission.txUnderrunsBase = i2sStats.txUnderruns;
+    txStreaming = true;
+  }
   size_t bytesWritten = 0;
   i2s_write(I2S_PORT, data, samples * sizeof(int16_t), &bytesWritten, portMAX_DELAY);
+  i2sStats.txSamples += bytesWritten / sizeof(int16_t);
+}
+
+void i2sStreamEnd() {
+  txStreaming = false;
 }
 
 void initializeSA868() {
@@ -235,8 +247,10 @@ void initializeSA868() {
     Serial.println("SA868: " + response);
   }
 
-  // Set filter (all on - pre-emph, highpass, lowpass)
-  SA868.println("AT+SETFILTER=0,0,0");
+  // Set filter (all on - pre-emph, highpass, lowpass). The high-pass takes
+  // CTCSS/DCS out of the audio, so it is bypassed when we decode them
+  // ourselves (our own capture high-pass still keeps it out of recordings).
+  SA868.println(ctcssDecode ? "AT+SETFILTER=0,1,0" : "AT+SETFILTER=0,0,0");
   delay(500);
   while (SA868.available()) {
     String response = SA868.readStringUntil('\n');
@@ -272,70 +286,350 @@ int getRSSI() {
   return 0;
 }
 
+// ==================== Squelch Edges ====================
+// pinAudioOn is watched by an ISR instead of being polled from loop(), so the
+// time the squelch opened/closed is known to the microsecond and can be
+// mapped onto the capture sample counter.
+
+static portMUX_TYPE squelchMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t squelchBurstUs = 0;     // First edge of the latest (possibly bouncing) transition
+static int64_t squelchLastEdgeUs = 0;  // Most recent edge
+static int squelchPinLevel = HIGH;
+static uint32_t squelchEdges = 0;
+
+static bool squelchOpen = false;       // Debounced state
+static uint32_t squelchEdgeSample = 0; // Capture sample where squelchOpen last changed
+
+static void IRAM_ATTR squelchISR() {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL_ISR(&squelchMux);
+  if (now - squelchLastEdgeUs > SQUELCH_DEBOUNCE_US) squelchBurstUs = now;
+  squelchLastEdgeUs = now;
+  squelchPinLevel = digitalRead(pinAudioOn);
+  squelchEdges++;
+  portEXIT_CRITICAL_ISR(&squelchMux);
+}
+
+void initSquelch() {
+  squelchPinLevel = digitalRead(pinAudioOn);
+  squelchOpen = squelchPinLevel == LOW;
+  attachInterrupt(digitalPinToInterrupt(pinAudioOn), squelchISR, CHANGE);
+  Serial.printf("Squelch edge interrupt on pin %d\n", pinAudioOn);
+}
+
+// Debounced squelch state - only changes once the pin has been quiet for
+// SQUELCH_DEBOUNCE_US, and then dates the change to the first edge of the burst
+static void updateSquelch() {
+  portENTER_CRITICAL(&squelchMux);
+  int64_t burstUs = squelchBurstUs;
+  int64_t lastEdgeUs = squelchLastEdgeUs;
+  int level = squelchPinLevel;
+  portEXIT_CRITICAL(&squelchMux);
+
+  bool open = level == LOW;  // Audio ON pin goes LOW when receiving
+  if (open != squelchOpen && esp_timer_get_time() - lastEdgeUs >= SQUELCH_DEBOUNCE_US) {
+    squelchOpen = open;
+    squelchEdgeSample = captureSampleAt(burstUs);
+  }
+}
+
 bool isReceiving() {
+  updateSquelch();
   // Ignore squelch pin in AP mode or while WiFi is settling (RF noise causes false triggers)
   if (apMode || millis() < wifiReadyTime) return false;
-  // Audio ON pin goes LOW when receiving
-  return digitalRead(pinAudioOn) == LOW;
+  return squelchOpen;
+}
+
+// Voice activity over the current recording (marks the trim points)
+static VadState vad;
+
+// Capture filters: DC blocker and CTCSS high-pass clean up every block
+// before it is metered, DTMF-scanned or stored. De-emphasis (optional)
+// comes after the DTMF scan so it doesn't add twist to the tone pairs.
+static Biquad cleanupFilters[BIQUAD_MAX_STAGES];
+static int cleanupStages = 0;
+static Biquad deemphasisFilter;
+static bool filtersPrimed = false;
+FilterStats filterStats = {};
+
+static void initCaptureFilters() {
+  cleanupStages = 0;
+  if (filterDcBlock) {
+    biquadDcBlocker(cleanupFilters[cleanupStages++], FILTER_DC_POLE);
+  }
+  if (filterHighpass) {
+    // Butterworth, as two sections
+    biquadHighpass(cleanupFilters[cleanupStages++], FILTER_HIGHPASS_HZ, 0.5412f);
+    biquadHighpass(cleanupFilters[cleanupStages++], FILTER_HIGHPASS_HZ, 1.3066f);
+  }
+  biquadDeemphasis(deemphasisFilter, FILTER_DEEMPHASIS_US, FILTER_DEEMPHASIS_ZERO_HZ);
+  filtersPrimed = false;
+}
+
+static void recordFilterCycles(uint32_t cycles) {
+  filterStats.blocks++;
+  filterStats.cycles += cycles;
+  if (cycles > filterStats.maxCycles) filterStats.maxCycles = cycles;
+  if (cycles > FILTER_CYCLE_BUDGET) filterStats.overBudget++;
+}
+
+// Streaming DTMF decoder over the recording, and the command it spells
+static DtmfDetector dtmf;
+static DtmfSequence dtmfSequence;
+
+static void commandComplete() {
+  strcpy(dtmfCommand, dtmfSequence.digits);
+  Serial.printf("*** DTMF command: %s ***\n", dtmfCommand);
+}
+
+void initDTMF() {
+  dtmfInit(dtmf, dtmfLowRate ? DTMF_LOW_RATE_BLOCK_SIZE : DTMF_BLOCK_SIZE, dtmfLowRate);
+  Serial.printf("DTMF: %.0f Hz, %d-sample blocks\n", dtmf.sampleRate, dtmf.blockSize);
+}
+
+// Sub-audible decoders (CTCSS tone, DCS code), fed the capture before any
+// filtering through one CIC down to SUBAUDIBLE_RATE
+static CicDecimator subaudible;
+static CtcssDecoder ctcss;
+static DcsDecoder dcs;
+static uint32_t dcsCycles = 0;
+static uint32_t dcsSamples = 0;
+
+// MDC1200 ANI burst decoder, on the filtered audio like DTMF
+static MdcDecoder mdc;
+static uint32_t mdcCycles = 0;
+
+// AFSK1200 (APRS and other AX.25 packet) heard on the channel is just logged
+static Ax25Decoder packet;
+static uint32_t packetCycles = 0;
+
+void initToneDecoders() {
+  ctcssReset(ctcss);
+  dcsInit(dcs, SUBAUDIBLE_RATE);
+  mdcInit(mdc, SAMPLE_RATE);
+  ax25Init(packet, SAMPLE_RATE);
+}
+
+static void recordSamples(uint32_t endSample);
+
+// Held by the record task for each drain, and by startRecording() and
+// stopRecording() from loop(), so only one of them reads the ring at a time
+static SemaphoreHandle_t recordMutex = nullptr;
+
+static void recordTask(void* param) {
+  for (;;) {
+    xSemaphoreTake(recordMutex, portMAX_DELAY);
+    if (recording) {
+      recordSamples(captureWritePosition());
+    } else {
+      captureFlush();  // Keep up while idle; startRecording() seeks back for the pre-roll
+    }
+    xSemaphoreGive(recordMutex);
+    vTaskDelay(pdMS_TO_TICKS(RECORD_TASK_PERIOD_MS));
+  }
+}
+
+void initRecorder() {
+  recordMutex = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(recordTask, "record", RECORD_TASK_STACK, NULL,
+                          RECORD_TASK_PRIORITY, NULL, RECORD_TASK_CORE);
+  Serial.printf("Record task started on core %d\n", RECORD_TASK_CORE);
 }
 
 void startRecording() {
+  xSemaphoreTake(recordMutex, portMAX_DELAY);
   recording = true;
   recordIndex = 0;
   peakRSSI = 0;
   minRSSI = 999;
   peakAudioLevel = 0;
   clipCount = 0;
-  detectedDTMF = 0;  // Reset DTMF detection
+  dtmfCommand[0] = 0;  // Reset DTMF detection
+  dtmfReset(dtmf);
+  dtmfSequenceReset(dtmfSequence);
+  cicReset(subaudible, SUBAUDIBLE_DECIMATION);
+  ctcssReset(ctcss);
+  dcsReset(dcs);
+  dcsCycles = 0;
+  dcsSamples = 0;
+  callerCtcss = -1;
+  callerDcs = -1;
+  callerDcsTwin = -1;
+  mdcReset(mdc);
+  mdcCycles = 0;
+  callerUnit = -1;
+  ax25Reset(packet);
+  packetCycles = 0;
+  vadReset(vad);
+  initCaptureFilters();
+  beginActivity(lastRecording);
+
+  // Drops the last recording if it was never saved (a DTMF command, etc.)
+  beginRecording();
+
+  // Start prerollMs before the sample where the squelch opened, so the
+  // first syllable is part of the recording. The ring already holds it.
+  uint32_t prerollSamples = (uint32_t)SAMPLE_RATE * prerollMs / 1000;
+  captureSeek(squelchEdgeSample - prerollSamples);
+  recordPreroll = max(0, (int32_t)(squelchEdgeSample - capturePosition()));
+
+  Serial.printf("Recording started at sample %u (%d samples pre-roll)...\n",
+                squelchEdgeSample, recordPreroll);
+  xSemaphoreGive(recordMutex);
+}
+
+// Record exactly up to the sample where the squelch closed, waiting briefly
+// for the capture task to get there. Anything already read past it is cut.
+static void recordUntil(uint32_t endSample) {
+  uint32_t waitStart = millis();
+  while ((int32_t)(endSample - captureWritePosition()) > 0 && millis() - waitStart < 100) {
+    vTaskDelay(1);
+  }
+  recordSamples(endSample);
 
-  Serial.println("Recording started...");
+  int32_t overshoot = (int32_t)(capturePosition() - endSample);
+  if (overshoot > 0) {
+    recordIndex = max(recordPreroll, recordIndex - (int)overshoot);
+  }
 }
 
 void stopRecording() {
+  xSemaphoreTake(recordMutex, portMAX_DELAY);
   recording = false;
+
+  // Squelch closed: end on the closing edge. Still open (timeout): end now.
+  if (!squelchOpen) {
+    recordUntil(squelchEdgeSample);
+  }
+
   Serial.printf("Recording stopped. %d samples captured.\n", recordIndex);
   Serial.printf("RSSI: min=%d, peak=%d\n", minRSSI, peakRSSI);
   Serial.printf("Audio: peak=%.1f, clipped samples=%d\n", peakAudioLevel, clipCount);
-}
-
-void recordAudioSamples() {
-  // Read a chunk of samples from I2S
-  int16_t samples[256];
-  size_t bytesRead = 0;
-
-  esp_err_t err = i2s_read(I2S_PORT, samples, sizeof(samples), &bytesRead, 0);
-  if (err != ESP_OK || bytesRead == 0) return;
+  if (!dtmfSequence.complete && dtmfSequenceFinish(dtmfSequence)) commandComplete();
+  if (ctcssDecode) {
+    callerCtcss = ctcssResult(ctcss);
+    if (callerCtcss >= 0) {
+      Serial.printf("CTCSS: caller is sending %.1f Hz (code %02d)\n",
+                    CTCSS_TONE_TABLE[callerCtcss].hz, CTCSS_TONE_TABLE[callerCtcss].code);
+    } else {
+      Serial.println("CTCSS: no tone heard");
+    }
+    callerDcs = dcsResult(dcs);
+    callerDcsTwin = dcsTwin(dcs, callerDcs);
+    char name[5], twin[5];
+    dcsCodeName(callerDcs, name);
+    dcsCodeName(callerDcsTwin, twin);
+    Serial.printf("DCS: %s%s%s (%u cycles per second of audio)\n", callerDcs >= 0 ? name : "no code",
+                  callerDcsTwin >= 0 ? " = " : "", twin, dcsSamples ? (uint32_t)((uint64_t)dcsCycles * SUBAUDIBLE_RATE / dcsSamples) : 0);
+  }
+  Serial.printf("MDC1200: %d frames (%u cycles per second of audio)\n", mdc.frames,
+                recordIndex > 0 ? (uint32_t)((uint64_t)mdcCycles * SAMPLE_RATE / recordIndex) : 0);
+  Serial.printf("AX.25: %d frames (%u cycles per second of audio)\n", packet.frames,
+                recordIndex > 0 ? (uint32_t)((uint64_t)packetCycles * SAMPLE_RATE / recordIndex) : 0);
+  printCaptureStats();
+  if (filterStats.blocks > 0) {
+    Serial.printf("Filters: %d stages, avg %u cycles/block (max %u, budget %d, %u over)\n",
+                  cleanupStages + (filterDeemphasis ? 1 : 0), (uint32_t)(filterStats.cycles / filterStats.blocks),
+                  filterStats.maxCycles, FILTER_CYCLE_BUDGET, filterStats.overBudget);
+  }
+  endActivity(lastRecording, "recording");
 
-  int samplesRead = bytesRead / sizeof(int16_t);
+  // Work out how much leading carrier / trailing squelch tail to drop
+  if (vadTrimEnabled && vadTrimPoints(vad, recordIndex, recordTrimStart, recordTrimEnd)) {
+    Serial.printf("VAD: speech %d-%d, trimming %d leading + %d trailing samples\n",
+                  recordTrimStart, recordTrimEnd, recordTrimStart, recordIndex - recordTrimEnd);
+  } else {
+    recordTrimStart = 0;
+    recordTrimEnd = recordIndex;
+  }
+  xSemaphoreGive(recordMutex);
+}
 
-  for (int i = 0; i < samplesRead && recordIndex < MAX_SAMPLES; i++) {
-    int16_t sample = samples[i];
-    audioBuffer[recordIndex++] = sample;
+static void recordSamples(uint32_t endSample) {
+  // Drain what the capture task has queued, stopping at endSample
+  int16_t samples[CAPTURE_BLOCK_SAMPLES];
+  size_t samplesRead;
+  int maxSamples = maxRecordSeconds * SAMPLE_RATE;
+
+  for (;;) {
+    int32_t remaining = (int32_t)(endSample - capturePosition());
+    if (remaining <= 0) break;
+    samplesRead = captureRead(samples, min(CAPTURE_BLOCK_SAMPLES, (int)remaining));
+    if (samplesRead == 0) break;
+
+    // The CTCSS and DCS decoders want what the cleanup filters take out
+    if (ctcssDecode) {
+      int16_t subaudibleSamples[CAPTURE_BLOCK_SAMPLES / SUBAUDIBLE_DECIMATION + 1];
+      int subaudibleCount = cicDecimate(subaudible, samples, samplesRead, subaudibleSamples);
+      ctcssProcess(ctcss, subaudibleSamples, subaudibleCount);
+      uint32_t dcsStart = ESP.getCycleCount();
+      dcsProcess(dcs, subaudibleSamples, subaudibleCount);
+      dcsCycles += ESP.getCycleCount() - dcsStart;
+      dcsSamples += subaudibleCount;
+    }
 
-    // Track peak level
-    float level = abs(sample) / 32768.0;
-    if (level > peakAudioLevel) {
-      peakAudioLevel = level;
+    // Clean up DC and CTCSS first, so levels and clip counts are honest
+    uint32_t filterStart = ESP.getCycleCount();
+    if (cleanupStages > 0) {
+      if (!filtersPrimed) {
+        biquadPrime(cleanupFilters[0], samples[0]);
+        filtersPrimed = true;
+      }
+      biquadProcess(cleanupFilters, cleanupStages, samples, samplesRead);
+    }
+    uint32_t filterCycles = ESP.getCycleCount() - filterStart;
+
+    // DTMF detection on every sample of the recording, grouped into a
+    // command sequence as the digits arrive
+    DtmfDigit digits[2];
+    int found = dtmfProcess(dtmf, samples, samplesRead, digits, 2);
+    for (int i = 0; i < found; i++) {
+      Serial.printf("DTMF %c at %.3f s (sample %u)\n", digits[i].digit,
+                    (float)digits[i].onsetSample / SAMPLE_RATE, digits[i].onsetSample);
+      if (dtmfSequenceAdd(dtmfSequence, digits[i])) commandComplete();
     }
+    if (dtmfSequenceCheckTimeout(dtmfSequence, dtmf.position * dtmf.decimation, SAMPLE_RATE)) commandComplete();
 
-    // Detect clipping
-    if (abs(sample) > CLIP_THRESHOLD) {
-      clipCount++;
+    // MDC1200 ANI, usually right at key-up; the last unit heard wins
+    uint32_t mdcStart = ESP.getCycleCount();
+    if (mdcProcess(mdc, samples, samplesRead)) {
+      callerUnit = mdc.last.unit;
+      Serial.printf("MDC1200: unit %04X (op %02X, arg %02X)\n", mdc.last.unit, mdc.last.op, mdc.last.arg);
     }
-  }
+    mdcCycles += ESP.getCycleCount() - mdcStart;
+
+    uint32_t packetStart = ESP.getCycleCount();
+    if (ax25Process(packet, samples, samplesRead)) {
+      char text[AX25_MAX_FRAME + 80];
+      if (ax25Format(packet.last, packet.lastLength, text, sizeof(text))) {
+        Serial.printf("AX.25: %s\n", text);
+      }
+    }
+    packetCycles += ESP.getCycleCount() - packetStart;
 
-  // DTMF detection - check periodically during recording
-  // Only detect once (first DTMF wins)
-  static int dtmfCheckCounter = 0;
-  dtmfCheckCounter += samplesRead;
-  if (detectedDTMF == 0 && dtmfCheckCounter >= DTMF_BLOCK_SIZE && recordIndex >= DTMF_BLOCK_SIZE) {
-    dtmfCheckCounter = 0;
-    // Check the most recent samples for DTMF
-    int startIdx = max(0, recordIndex - DTMF_BLOCK_SIZE);
-    char dtmf = detectDTMF(&audioBuffer[startIdx], DTMF_BLOCK_SIZE);
-    if ((dtmf >= '1' && dtmf <= '9') || dtmf == '*' || dtmf == '#') {
-      detectedDTMF = dtmf;
-      Serial.printf("*** DTMF %c detected ***\n", dtmf);
+    if (filterDeemphasis) {
+      filterStart = ESP.getCycleCount();
+      biquadProcess(&deemphasisFilter, 1, samples, samplesRead);
+      filterCycles += ESP.getCycleCount() - filterStart;
+    }
+    recordFilterCycles(filterCycles);
+
+    int blockStart = recordIndex;
+    int count = min((int)samplesRead, maxSamples - recordIndex);
+    if (count > 0) {
+      // Chunks are allocated as the recording grows (evicting if need be)
+      count = appendRecording(samples, count);
+      recordIndex += count;
+
+      // Peak level, clipping and voice activity from one block record
+      BlockLevel level;
+      blockLevel(samples, count, level);
+      float peak = level.peak / 32768.0f;
+      if (peak > peakAudioLevel) {
+        peakAudioLevel = peak;
+      }
+      clipCount += level.clips;
+      vadProcess(vad, samples, count, blockStart, level);
     }
   }
 
@@ -347,64 +641,64 @@ void recordAudioSamples() {
   }
 }
 
-void generateQualityFeedback() {
+void generateQualityFeedback(TxJob* job) {
   if (peakRSSI > 140) {
-    playTone(1200, 200);
-    playVoiceMessage("excellent signal");
+    txEarcon(job, EARCON_EXCELLENT);
+    txSpeech(job, "excellent signal");
   } else if (peakRSSI > 120) {
-    playTone(1000, 200);
-    delay(100);
-    playTone(1000, 200);
-    playVoiceMessage("good signal");
+    txEarcon(job, EARCON_GOOD);
+    txSpeech(job, "good signal");
   } else if (peakRSSI > 100) {
-    playTone(800, 200);
-    delay(100);
-    playTone(800, 200);
-    delay(100);
-    playTone(800, 200);
-    playVoiceMessage("fair signal");
+    txEarcon(job, EARCON_FAIR);
+    txSpeech(job, "fair signal");
   } else if (peakRSSI > 0) {
-    playTone(400, 500);
-    playVoiceMessage("weak signal, check antenna");
+    txEarcon(job, EARCON_WEAK);
+    txSpeech(job, "weak signal, check antenna");
   } else {
-    playTone(300, 300);
-    delay(100);
-    playTone(300, 300);
-    playVoiceMessage("no signal");
+    txEarcon(job, EARCON_NO_SIGNAL);
+    txSpeech(job, "no signal");
   }
 
   if (clipCount > CLIP_COUNT_WARN) {
-    delay(300);
-    playVoiceMessage("audio clipping, reduce volume");
+    txSilence(job, 300);
+    txSpeech(job, "audio clipping, reduce volume");
   }
-}
-
-void playbackWithFeedback() {
-  Serial.println("Starting playback...");
 
-  // Key PTT
-  pttOn();
-  delay(300);  // PTT tail delay
-
-  speakPreMessage();
-
-  // Play back recorded audio via I2S
-  for (int i = 0; i < recordIndex; i += 256) {
-    int chunkSize = min(256, recordIndex - i);
-    i2sWrite(&audioBuffer[i], chunkSize);
+  // The caller's CTCSS tone or DCS code, the usual reason a walkie can't
+  // hear the others
+  if (ctcssDecode) {
+    txSilence(job, 300);
+    if (callerCtcss >= 0) {
+      String message = "your tone is " + String(CTCSS_TONE_TABLE[callerCtcss].hz, 1) + " hertz";
+      txSpeech(job, message);
+    } else if (callerDcs >= 0) {
+      // Spelled out digit by digit, with the other polarity's twin code
+      char name[5], twin[5];
+      dcsCodeName(callerDcs, name);
+      dcsCodeName(callerDcsTwin, twin);
+      String message = "your code is D C S " + String(name[0]) + " " + String(name[1]) + " " + String(name[2]);
+      message += name[3] == 'I' ? " inverted" : " normal";
+      if (callerDcsTwin >= 0) {
+        message += ", same as " + String(twin[0]) + " " + String(twin[1]) + " " + String(twin[2]);
+        message += twin[3] == 'I' ? " inverted" : " normal";
+      }
+      txSpeech(job, message);
+    } else {
+      txSpeech(job, "no tone");
+    }
   }
+}
 
-  delay(500);  // Gap before feedback tones
-
-  // Generate quality feedback
-  generateQualityFeedback();
-
-  speakPostMessage();
-
-  delay(300);  // Final tail
-
-  // Release PTT
-  pttOff();
-
-  Serial.println("Playback complete!");
+// Queued as one job, keyed once; the feedback is worked out now, from the
+// figures of the recording just made
+void playbackWithFeedback(int slotIndex) {
+  Serial.println("Queueing playback...");
+
+  TxJob* job = txNewJob("reply", REPLY_WAIT_MS, 300, 300);  // PTT tail delay, final tail
+  txPreMessage(job);
+  txRecording(job, slotIndex);
+  txSilence(job, 500);  // Gap before feedback tones
+  generateQualityFeedback(job);
+  txPostMessage(job);
+  txSubmit(job);
 }
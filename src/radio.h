@@ -9,34 +9,75 @@ extern HardwareSerial SA868;
 
 // I2S audio functions
 void initI2S();
-void i2sWrite(int16_t* data, size_t samples);
+void i2sWrite(const int16_t* data, size_t samples);
+void i2sStreamEnd();  // Last audio of the transmission is queued; the output may run dry now
+
+// I2S driver events, drained from the driver's event queue by the capture task
+struct I2sStats {
+  uint32_t rxOverflows;      // I2S_EVENT_RX_Q_OVF: input DMA buffers lost
+  uint32_t txUnderruns;      // I2S_EVENT_TX_Q_OVF while streaming: output ran dry mid-transmission
+  uint32_t dmaErrors;        // I2S_EVENT_DMA_ERROR
+  int64_t lastRxOverflowUs;  // esp_timer time the last one was seen (0 = never)
+  int64_t lastTxUnderrunUs;
+  uint32_t txSamples;        // Written by i2sWrite() since boot
+};
+extern I2sStats i2sStats;
+void pollI2SEvents();
+
+// When we last recorded / transmitted, and the I2S glitches during it
+struct AirActivity {
+  uint32_t count;            // Recordings / transmissions since boot
+  time_t started;            // Wall clock (0 if the time was not set)
+  int64_t startUs;           // esp_timer, same clock as the I2S event times
+  int64_t endUs;             // 0 while still in progress
+  uint32_t rxOverflows;      // I2S events since startUs
+  uint32_t txUnderruns;
+  uint32_t rxOverflowsBase;  // Counters when it started
+  uint32_t txUnderrunsBase;
+};
+extern AirActivity lastRecording;
+extern AirActivity lastTransmission;
 
 // SA868 radio functions
 void initializeSA868();
 int getRSSI();
+void initSquelch();
 bool isReceiving();
 
-// PTT control
+// PTT control (only the TX task keys up; see tx.h)
 void pttOn();
 void pttOff();
 
-// Recording functions
+// Capture filter cost per block, against FILTER_CYCLE_BUDGET
+struct FilterStats {
+  uint32_t blocks;
+  uint64_t cycles;
+  uint32_t maxCycles;
+  uint32_t overBudget;
+};
+extern FilterStats filterStats;
+
+// Recording functions (the record task drains the capture ring into the
+// recorder, meters and decoders while a recording is running)
+void initRecorder();
 void startRecording();
 void stopRecording();
-void recordAudioSamples();
 
-// DTMF detection
-void initGoertzel();
-char detectDTMF(int16_t* samples, int count);
+// DTMF detection (decoder lives in dtmf.h)
+void initDTMF();
+
+// CTCSS, DCS, MDC1200 and AX.25 packet detection (decoders live in ctcss.h,
+// dcs.h, mdc.h and ax25.h)
+void initToneDecoders();
 
-// Slot functions
-void initSlots();
-void saveToSlot(int slotIndex);
+// Replies and beacons: these queue a job for the TX task (tx.h) and return
+struct TxJob;
 void playSlot(int slotIndex);
 void playRadioTest();
+void sendTelemetryBeacon();  // AX.25 over AFSK1200, modem lives in ax25.h
 
 // Playback
-void playbackWithFeedback();
-void generateQualityFeedback();
+void playbackWithFeedback(int slotIndex);
+void generateQualityFeedback(TxJob* job);  // Adds the tones and words to a reply
 
 #endif // RADIO_H
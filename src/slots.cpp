@@ -0,0 +1,506 @@
+#include "slots.h"
+#include "config.h"
+#include "arena.h"
+#include "adpcm.h"
+#include "dsp.h"
+#include <esp_heap_caps.h>
+
+// Save order, used to find the oldest recording for FIFO eviction
+static uint32_t slotSequence = 0;
+
+// Guards slot metadata shared between loop() and the compression task
+static SemaphoreHandle_t slotsMutex = nullptr;
+static QueueHandle_t compressQueue = nullptr;
+
+// The recording in progress (or just finished and not yet saved), stored
+// at SAMPLE_RATE / recordFactor
+static AudioChunk* recordHead = nullptr;
+static AudioChunk* recordTail = nullptr;
+static int recordStored = 0;
+static int recordFactor = 1;
+static Decimator recordDecimator;
+
+AdpcmStats adpcmStats = {};
+
+static void compressTask(void* param);
+static bool evictSlotExcept(int spare);
+
+// ==================== Chunks ====================
+
+#define PCM_CHUNK_BYTES (sizeof(AudioChunk) + CHUNK_SAMPLES * sizeof(int16_t))
+#define ADPCM_CHUNK_BYTES (sizeof(AudioChunk) + (CHUNK_SAMPLES / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES)
+
+static AudioChunk* allocChunk(size_t bytes) {
+  AudioChunk* chunk = (AudioChunk*)arenaAlloc(bytes);
+  if (chunk) {
+    chunk->next = nullptr;
+    chunk->count = 0;
+  }
+  return chunk;
+}
+
+static void freeChunks(AudioChunk* chunk) {
+  while (chunk) {
+    AudioChunk* next = chunk->next;
+    arenaFree(chunk);
+    chunk = next;
+  }
+}
+
+static inline int16_t* chunkSamples(const AudioChunk* chunk) {
+  return (int16_t*)(chunk + 1);
+}
+
+static inline uint8_t* chunkBytes(const AudioChunk* chunk) {
+  return (uint8_t*)(chunk + 1);
+}
+
+// ==================== Slots ====================
+
+bool initSlots() {
+  for (int i = 0; i < MAX_SLOTS; i++) {
+    slots[i].chunks = nullptr;
+    slots[i].startOffset = 0;
+    slots[i].sampleCount = 0;
+    slots[i].sequence = 0;
+    slots[i].format = SLOT_PCM16;
+    slots[i].decimation = 1;
+    slots[i].pinned = false;
+    slots[i].readers = 0;
+    slots[i].trimmedSamples = 0;
+    slots[i].unitId = -1;
+  }
+
+  // Everything but a small reserve for eSpeak, HTTP and friends
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  if (largest <= ARENA_PSRAM_RESERVE + RECORD_RESERVE_BYTES ||
+      !initArena(largest - ARENA_PSRAM_RESERVE)) {
+    Serial.println("ERROR: Not enough PSRAM for the recording arena!");
+    return false;
+  }
+  Serial.printf("Recording arena: %d bytes in PSRAM (%d slots max)\n", arenaSize(), MAX_SLOTS);
+
+  slotsMutex = xSemaphoreCreateMutex();
+  compressQueue = xQueueCreate(MAX_SLOTS, sizeof(int));
+  xTaskCreatePinnedToCore(compressTask, "compress", COMPRESS_TASK_STACK, NULL,
+                          COMPRESS_TASK_PRIORITY, NULL, COMPRESS_TASK_CORE);
+
+  Serial.printf("PSRAM remaining: %d bytes\n", ESP.getFreePsram());
+  return true;
+}
+
+// Keep a few seconds of arena free after every save, so short recordings
+// (DTMF commands in particular) never have to evict anything
+void ensureRecordReserve() {
+  while (arenaFreeBytes() < RECORD_RESERVE_BYTES) {
+    if (!evictSlot()) break;
+  }
+}
+
+// ==================== Recording ====================
+
+// Store samples at the end of the recording, growing it a chunk at a time.
+// Returns how many were stored (fewer only if the arena is exhausted).
+static int storeSamples(const int16_t* samples, int count) {
+  int stored = 0;
+  while (stored < count) {
+    if (!recordTail || recordTail->count >= CHUNK_SAMPLES) {
+      AudioChunk* chunk;
+      while (!(chunk = allocChunk(PCM_CHUNK_BYTES))) {
+        if (!evictSlot()) return stored;
+      }
+      if (recordTail) recordTail->next = chunk;
+      else recordHead = chunk;
+      recordTail = chunk;
+    }
+    int n = min(count - stored, CHUNK_SAMPLES - (int)recordTail->count);
+    memcpy(chunkSamples(recordTail) + recordTail->count, samples + stored, n * sizeof(int16_t));
+    recordTail->count += n;
+    stored += n;
+  }
+  recordStored += stored;
+  return stored;
+}
+
+// Append captured (SAMPLE_RATE) samples to the recording, decimating them
+// to the storage rate. Returns how many were taken; fewer than count only
+// when the arena is exhausted.
+int appendRecording(const int16_t* samples, int count) {
+  if (recordFactor <= 1) return storeSamples(samples, count);
+
+  int16_t decimated[CAPTURE_BLOCK_SAMPLES];
+  int taken = 0;
+  while (taken < count) {
+    int n = min(count - taken, CAPTURE_BLOCK_SAMPLES);
+    int produced = decimate(recordDecimator, samples + taken, n, decimated);
+    if (storeSamples(decimated, produced) < produced) return taken;
+    taken += n;
+  }
+  return taken;
+}
+
+// Drop any unsaved recording and start a new one at the current storage rate
+void beginRecording() {
+  freeChunks(recordHead);
+  recordHead = nullptr;
+  recordTail = nullptr;
+  recordStored = 0;
+  recordFactor = constrain(storageDecimation, 1, RESAMPLE_MAX_FACTOR);
+  decimatorReset(recordDecimator, recordFactor);
+}
+
+// Caller holds slotsMutex, and nobody is reading the slot
+static void releaseSlot(int slotIndex) {
+  freeChunks(slots[slotIndex].chunks);
+  slots[slotIndex].chunks = nullptr;
+  slots[slotIndex].sampleCount = 0;
+}
+
+// Next slot in rotation that is neither pinned nor being played, with its
+// old recording dropped. nextSlot only moves past the slot actually taken.
+static int claimNextSlot() {
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  int claimed = -1;
+  for (int tries = 0; tries < MAX_SLOTS && claimed < 0; tries++) {
+    int slotIndex = (nextSlot + tries) % MAX_SLOTS;
+    if (slots[slotIndex].pinned || slots[slotIndex].readers > 0) continue;
+    releaseSlot(slotIndex);
+    nextSlot = (slotIndex + 1) % MAX_SLOTS;
+    claimed = slotIndex;
+  }
+  xSemaphoreGive(slotsMutex);
+  return claimed;
+}
+
+// Moves the recording into the next slot in rotation. A slot is only
+// claimed (and its old recording dropped) once there is something to put
+// in it, so a failed save never leaves a stale recording to be played back
+// as the reply.
+int saveRecording() {
+  if (!recordHead) return -1;
+
+  // Trim points are in captured samples, the chain is at the storage rate
+  int captureEnd = constrain(recordTrimEnd, 0, recordIndex);
+  int skip = constrain(recordTrimStart, 0, captureEnd) / recordFactor;
+  int end = min(captureEnd / recordFactor, recordStored);
+  int keep = end - skip;
+  if (keep <= 0) return -1;
+  int trimmed = max(0, recordIndex - keep * recordFactor);
+
+  int slotIndex = claimNextSlot();
+  if (slotIndex < 0) {
+    Serial.println("No free slot, recording not saved");
+    return -1;
+  }
+
+  // Trim the chain to the VAD trim points: whole chunks outside them are
+  // freed, the rest is handed to the slot as-is - no audio is copied
+  AudioChunk* head = recordHead;
+  while (head && skip >= head->count) {
+    skip -= head->count;
+    AudioChunk* next = head->next;
+    arenaFree(head);
+    head = next;
+  }
+  AudioChunk* last = head;
+  int left = skip + keep;
+  while (last && left > last->count) {
+    left -= last->count;
+    last = last->next;
+  }
+  if (last) {
+    last->count = left;
+    freeChunks(last->next);
+    last->next = nullptr;
+    arenaShrink(last, sizeof(AudioChunk) + left * sizeof(int16_t));
+  }
+  recordHead = nullptr;
+  recordTail = nullptr;
+  recordStored = 0;
+
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  slots[slotIndex].chunks = head;
+  slots[slotIndex].startOffset = skip;
+  slots[slotIndex].sampleCount = keep;
+  slots[slotIndex].trimmedSamples = trimmed;
+  slots[slotIndex].unitId = callerUnit;
+  slots[slotIndex].sequence = ++slotSequence;
+  slots[slotIndex].format = SLOT_PCM16;
+  slots[slotIndex].decimation = recordFactor;
+  xSemaphoreGive(slotsMutex);
+  Serial.printf("Saved %d samples at %d Hz to slot %d (%d trimmed)\n", keep, SAMPLE_RATE / recordFactor,
+                slotIndex + 1, trimmed);
+
+  if (slotCompression) {
+    xQueueSend(compressQueue, &slotIndex, 0);
+  }
+
+  ensureRecordReserve();
+  printSlotStats();
+  return slotIndex;
+}
+
+bool clearSlot(int slotIndex) {
+  if (slotIndex < 0 || slotIndex >= MAX_SLOTS || !slotsMutex) return false;
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  bool idle = slots[slotIndex].readers == 0;
+  if (idle) releaseSlot(slotIndex);
+  xSemaphoreGive(slotsMutex);
+  if (!idle) Serial.printf("Slot %d is playing, not cleared\n", slotIndex + 1);
+  return idle;
+}
+
+bool evictSlot() {
+  return evictSlotExcept(-1);
+}
+
+// Free one unpinned recording chosen by the eviction policy, passing over
+// spare and any slot being played
+static bool evictSlotExcept(int spare) {
+  if (!slotsMutex) return false;
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  int victim = -1;
+  for (int i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].sampleCount == 0 || slots[i].pinned || slots[i].readers > 0 || i == spare) continue;
+    if (victim < 0) {
+      victim = i;
+    } else if (slotEvictPolicy == EVICT_LONGEST) {
+      if (slots[i].sampleCount * slots[i].decimation > slots[victim].sampleCount * slots[victim].decimation) victim = i;
+    } else {
+      if (slots[i].sequence < slots[victim].sequence) victim = i;
+    }
+  }
+  if (victim >= 0) {
+    Serial.printf("Evicting slot %d (%d samples)\n", victim + 1, slots[victim].sampleCount);
+    releaseSlot(victim);
+  }
+  xSemaphoreGive(slotsMutex);
+  return victim >= 0;
+}
+
+bool setSlotPinned(int slotIndex, bool pinned) {
+  if (slotIndex < 0 || slotIndex >= MAX_SLOTS || !slotsMutex) return false;
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  bool ok = !pinned || slots[slotIndex].sampleCount > 0;  // Nothing to keep in an empty slot
+  if (ok) slots[slotIndex].pinned = pinned;
+  xSemaphoreGive(slotsMutex);
+  if (ok) Serial.printf("Slot %d %s\n", slotIndex + 1, pinned ? "pinned" : "unpinned");
+  return ok;
+}
+
+int usedSlotCount() {
+  int used = 0;
+  for (int i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].sampleCount > 0) used++;
+  }
+  return used;
+}
+
+void printSlotStats() {
+  Serial.printf("Slots: %d used, arena %d/%d bytes free (largest %d, %d extents)\n",
+                usedSlotCount(), arenaFreeBytes(), arenaSize(), arenaLargestFree(), arenaExtentCount());
+}
+
+// ==================== Slot Playback ====================
+
+bool openSlotReader(SlotReader& reader, int slotIndex) {
+  reader.slotIndex = -1;
+  reader.chunk = nullptr;
+  reader.remaining = 0;
+  if (slotIndex < 0 || slotIndex >= MAX_SLOTS || !slotsMutex) return false;
+
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  const RecordingSlot& slot = slots[slotIndex];
+  bool ok = slot.chunks && slot.sampleCount > 0;
+  if (ok) {
+    slots[slotIndex].readers++;
+    reader.slotIndex = slotIndex;
+    reader.chunk = slot.chunks;
+    reader.offset = slot.startOffset;
+    reader.remaining = slot.sampleCount;
+    reader.format = slot.format;
+    reader.decodedBlock = nullptr;
+    interpolatorReset(reader.interp, slot.decimation);
+  }
+  xSemaphoreGive(slotsMutex);
+  return ok;
+}
+
+// The recording just captured, for when it could not be saved to a slot
+bool openRecordingReader(SlotReader& reader) {
+  reader.slotIndex = -1;
+  reader.chunk = recordHead;
+  reader.offset = 0;
+  reader.remaining = recordStored;
+  reader.format = SLOT_PCM16;
+  reader.decodedBlock = nullptr;
+  interpolatorReset(reader.interp, recordFactor);
+  return reader.remaining > 0;
+}
+
+// Up to maxSamples stored samples, walking the chunk chain and decoding
+// ADPCM one block at a time
+static int readStored(SlotReader& reader, int16_t* out, int maxSamples) {
+  while (reader.chunk && reader.offset >= reader.chunk->count) {
+    reader.chunk = reader.chunk->next;
+    reader.offset = 0;
+  }
+  if (!reader.chunk || reader.remaining <= 0) return 0;
+
+  int count = min(min(maxSamples, (int)reader.chunk->count - reader.offset), reader.remaining);
+  if (reader.format == SLOT_ADPCM) {
+    int blockOffset = reader.offset % ADPCM_BLOCK_SAMPLES;
+    count = min(count, ADPCM_BLOCK_SAMPLES - blockOffset);
+    const uint8_t* block = chunkBytes(reader.chunk) + (reader.offset / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES;
+    // Each block is decoded once, even when read in smaller pieces
+    if (block != reader.decodedBlock) {
+      uint32_t start = ESP.getCycleCount();
+      adpcmDecodeBlock(block, min(ADPCM_BLOCK_SAMPLES, (int)reader.chunk->count - (reader.offset - blockOffset)),
+                       reader.decoded);
+      uint32_t cycles = ESP.getCycleCount() - start;
+      adpcmStats.decodedBlocks++;
+      adpcmStats.decodeCycles += cycles;
+      if (cycles > adpcmStats.maxDecodeCycles) adpcmStats.maxDecodeCycles = cycles;
+      reader.decodedBlock = block;
+    }
+    memcpy(out, reader.decoded + blockOffset, count * sizeof(int16_t));
+  } else {
+    memcpy(out, chunkSamples(reader.chunk) + reader.offset, count * sizeof(int16_t));
+  }
+  reader.offset += count;
+  reader.remaining -= count;
+  return count;
+}
+
+// Returns up to SLOT_READ_SAMPLES samples of 16-bit PCM at SAMPLE_RATE,
+// so any slot streams straight into i2sWrite() whatever its storage format
+int readSlotBlock(SlotReader& reader, int16_t* out) {
+  int factor = reader.interp.factor;
+  if (factor <= 1) return readStored(reader, out, SLOT_READ_SAMPLES);
+
+  int16_t stored[SLOT_READ_SAMPLES];
+  int count = readStored(reader, stored, SLOT_READ_SAMPLES / factor);
+  return interpolate(reader.interp, stored, count, out);
+}
+
+void closeSlotReader(SlotReader& reader) {
+  if (reader.slotIndex >= 0) {
+    xSemaphoreTake(slotsMutex, portMAX_DELAY);
+    slots[reader.slotIndex].readers--;
+    xSemaphoreGive(slotsMutex);
+  }
+  reader.slotIndex = -1;
+  reader.chunk = nullptr;
+  reader.remaining = 0;
+}
+
+void printAdpcmStats() {
+  if (adpcmStats.decodedBlocks == 0) return;
+  uint32_t avg = adpcmStats.decodeCycles / adpcmStats.decodedBlocks;
+  // Cycles available per block when playing at SAMPLE_RATE
+  uint32_t budget = ESP.getCpuFreqMHz() * 1000000UL / SAMPLE_RATE * ADPCM_BLOCK_SAMPLES;
+  Serial.printf("ADPCM decode: %u blocks, avg %u cycles/block (max %u), %.2f%% of real time\n",
+                adpcmStats.decodedBlocks, avg, adpcmStats.maxDecodeCycles, 100.0f * avg / budget);
+}
+
+// ==================== Background Compression ====================
+
+static bool slotUnchanged(int slotIndex, const RecordingSlot& snapshot) {
+  return slots[slotIndex].sequence == snapshot.sequence && slots[slotIndex].chunks == snapshot.chunks;
+}
+
+// Encode a saved PCM slot to an IMA-ADPCM chunk chain, then swap it in once
+// nobody is playing the slot. Reads a block at a time under the mutex so
+// loop() is never held up, and gives up if the slot is replaced meanwhile.
+static void compressSlot(int slotIndex) {
+  xSemaphoreTake(slotsMutex, portMAX_DELAY);
+  RecordingSlot snapshot = slots[slotIndex];
+  xSemaphoreGive(slotsMutex);
+  if (!snapshot.chunks || snapshot.sampleCount == 0 || snapshot.format != SLOT_PCM16) return;
+
+  uint32_t start = millis();
+  AudioChunk* head = nullptr;
+  AudioChunk* tail = nullptr;
+  const AudioChunk* src = snapshot.chunks;
+  int srcOffset = snapshot.startOffset;
+  int remaining = snapshot.sampleCount;
+  int16_t block[ADPCM_BLOCK_SAMPLES];
+
+  while (remaining > 0) {
+    if (!tail || tail->count >= CHUNK_SAMPLES) {
+      // Makes room the way saving does, but never at this slot's expense
+      AudioChunk* chunk;
+      while (!(chunk = allocChunk(ADPCM_CHUNK_BYTES))) {
+        if (!evictSlotExcept(slotIndex)) break;
+      }
+      if (!chunk) {
+        Serial.printf("Compression: no room to compress slot %d\n", slotIndex + 1);
+        freeChunks(head);
+        return;
+      }
+      if (tail) tail->next = chunk;
+      else head = chunk;
+      tail = chunk;
+    }
+
+    // Gather one block of PCM (it may straddle two source chunks)
+    int count = 0;
+    xSemaphoreTake(slotsMutex, portMAX_DELAY);
+    bool unchanged = slotUnchanged(slotIndex, snapshot);
+    while (unchanged && count < ADPCM_BLOCK_SAMPLES && count < remaining && src) {
+      if (srcOffset >= src->count) {
+        src = src->next;
+        srcOffset = 0;
+        continue;
+      }
+      int n = min(min(ADPCM_BLOCK_SAMPLES - count, remaining - count), (int)src->count - srcOffset);
+      memcpy(block + count, chunkSamples(src) + srcOffset, n * sizeof(int16_t));
+      count += n;
+      srcOffset += n;
+    }
+    xSemaphoreGive(slotsMutex);
+    if (!unchanged || count == 0) {
+      freeChunks(head);
+      return;
+    }
+
+    adpcmEncodeBlock(block, count, chunkBytes(tail) + (tail->count / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES);
+    tail->count += count;
+    remaining -= count;
+  }
+  // Give back the unused blocks of the last chunk
+  arenaShrink(tail, sizeof(AudioChunk) + adpcmEncodedBytes(tail->count));
+  int encodedBytes = adpcmEncodedBytes(snapshot.sampleCount);
+
+  // Wait for playback of the PCM version to finish before swapping
+  for (;;) {
+    xSemaphoreTake(slotsMutex, portMAX_DELAY);
+    if (!slotUnchanged(slotIndex, snapshot)) {
+      xSemaphoreGive(slotsMutex);
+      freeChunks(head);
+      return;
+    }
+    if (slots[slotIndex].readers == 0) {
+      slots[slotIndex].chunks = head;
+      slots[slotIndex].startOffset = 0;
+      slots[slotIndex].format = SLOT_ADPCM;
+      freeChunks(snapshot.chunks);
+      xSemaphoreGive(slotsMutex);
+      break;
+    }
+    xSemaphoreGive(slotsMutex);
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+
+  Serial.printf("Compressed slot %d: %d -> %d bytes in %lu ms\n", slotIndex + 1,
+                snapshot.sampleCount * (int)sizeof(int16_t), encodedBytes, millis() - start);
+}
+
+static void compressTask(void* param) {
+  int slotIndex;
+  for (;;) {
+    if (xQueueReceive(compressQueue, &slotIndex, portMAX_DELAY) == pdTRUE) {
+      compressSlot(slotIndex);
+    }
+  }
+}
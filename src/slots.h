@@ -0,0 +1,51 @@
+#ifndef SLOTS_H
+#define SLOTS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "dsp.h"
+#include "adpcm.h"
+
+// Recording slot storage (chunk chains in the PSRAM arena)
+bool initSlots();
+void ensureRecordReserve();
+void beginRecording();
+int appendRecording(const int16_t* samples, int count);
+int saveRecording();  // Returns the slot it went to, or -1 if it was not saved
+bool clearSlot(int slotIndex);  // False (and left alone) while the slot is being played
+bool evictSlot();
+bool setSlotPinned(int slotIndex, bool pinned);  // False if asked to pin an empty slot
+int usedSlotCount();
+void printSlotStats();
+
+// Streaming playback of a slot as 16-bit PCM at SAMPLE_RATE, whatever its
+// storage format and rate.
+// An open reader keeps the slot from being re-encoded underneath it.
+#define SLOT_READ_SAMPLES 256
+
+struct SlotReader {
+  int slotIndex;             // -1 = not open, or reading the unsaved recording
+  const AudioChunk* chunk;   // Chunk being read
+  int offset;                // Sample offset within the chunk
+  int remaining;             // Samples left to return
+  uint8_t format;
+  Interpolator interp;       // Back up to SAMPLE_RATE
+  const uint8_t* decodedBlock;  // ADPCM block held in decoded[]
+  int16_t decoded[ADPCM_BLOCK_SAMPLES];
+};
+
+bool openSlotReader(SlotReader& reader, int slotIndex);
+bool openRecordingReader(SlotReader& reader);
+int readSlotBlock(SlotReader& reader, int16_t* out);
+void closeSlotReader(SlotReader& reader);
+
+// ADPCM decode cost, to check playback keeps up with real time
+struct AdpcmStats {
+  uint32_t decodedBlocks;
+  uint64_t decodeCycles;
+  uint32_t maxDecodeCycles;
+};
+extern AdpcmStats adpcmStats;
+void printAdpcmStats();
+
+#endif // SLOTS_H
@@ -1,14 +1,55 @@
 #include "tts.h"
 #include "config.h"
+#include "slots.h"
 #include <WiFi.h>
 #include <time.h>
+#include <atomic>
 #include "espeak.h"
 
+// ==================== Speech Ring ====================
+// eSpeak runs on its own task, ahead of playback: each utterance is
+// synthesized into a PSRAM ring as soon as it is queued, and the TX task
+// streams it out from there. The first one is ready during the key-up
+// delay and the next ones are made while the previous ones play. Same
+// single-producer/single-consumer scheme as the capture ring: free-running
+// sample counters, each advanced by one side only.
+
+#define SPEECH_RING_MASK (TTS_RING_SAMPLES - 1)
+
+static int16_t* speechRing = nullptr;
+static std::atomic<uint32_t> speechWritten(0);   // Speech task only
+static std::atomic<uint32_t> speechRead(0);      // TX task only
+static uint32_t utteranceEnds[TTS_MAX_QUEUED];   // speechWritten when each one finished
+static std::atomic<uint32_t> utterancesDone(0);
+static uint32_t utterancesQueued = 0;            // Tickets handed out
+static QueueHandle_t speechQueueHandle = nullptr;
+static TaskHandle_t speechTaskHandle = nullptr;
+
+// Playback waiting on synthesis (dead air), since boot
+uint32_t speechStarvedMs = 0;
+
+static void speechPush(const int16_t* samples, int count) {
+  while (count > 0) {
+    uint32_t w = speechWritten.load(std::memory_order_relaxed);
+    uint32_t space = TTS_RING_SAMPLES - (w - speechRead.load(std::memory_order_acquire));
+    if (space == 0) {
+      vTaskDelay(1);  // Far enough ahead; wait for playback
+      continue;
+    }
+    uint32_t offset = w & SPEECH_RING_MASK;
+    int n = min(min((uint32_t)count, space), TTS_RING_SAMPLES - offset);
+    memcpy(&speechRing[offset], samples, n * sizeof(int16_t));
+    speechWritten.store(w + n, std::memory_order_release);
+    samples += n;
+    count -= n;
+  }
+}
+
 // TTS output buffer
 static int16_t ttsBuffer[512];
 static int ttsBufferIndex = 0;
 
-// eSpeak audio output — Print subclass that feeds our I2S
+// eSpeak audio output — Print subclass that feeds the speech ring
 class TTSOutput : public Print {
 public:
   size_t write(uint8_t b) override {
@@ -27,7 +68,7 @@ public:
         i += 2;
 
         if (ttsBufferIndex >= 512) {
-          i2sWrite(ttsBuffer, ttsBufferIndex);
+          speechPush(ttsBuffer, ttsBufferIndex);
           ttsBufferIndex = 0;
         }
       } else {
@@ -39,7 +80,7 @@ public:
 
   void flush() {
     if (ttsBufferIndex > 0) {
-      i2sWrite(ttsBuffer, ttsBufferIndex);
+      speechPush(ttsBuffer, ttsBufferIndex);
       ttsBufferIndex = 0;
     }
   }
@@ -97,12 +138,21 @@ String expandMacros(const String &text) {
   }
   // Slot macros
   result.replace("{slot}", String(nextSlot + 1));
-  int usedSlots = 0;
-  for (int i = 0; i < MAX_SLOTS; i++) {
-    if (slots[i].sampleCount > 0) usedSlots++;
-  }
-  result.replace("{slots_used}", String(usedSlots));
+  result.replace("{slots_used}", String(usedSlotCount()));
   result.replace("{slots_total}", String(MAX_SLOTS));
+  // Caller macros: the MDC1200 unit ID, spelled out hex digit by digit
+  if (callerUnit >= 0) {
+    char unit[8];
+    snprintf(unit, sizeof(unit), "%04X", callerUnit & 0xFFFF);
+    String spelled;
+    for (int i = 0; unit[i]; i++) {
+      if (i > 0) spelled += " ";
+      spelled += unit[i];
+    }
+    result.replace("{unit}", spelled);
+  } else {
+    result.replace("{unit}", "unknown");
+  }
   // Radio/system macros
   result.replace("{freq}", radioFreq);
   result.replace("{uptime}", String(millis() / 60000) + " minutes");
@@ -187,7 +237,33 @@ String sanitizeForTTS(String text) {
   return clean;
 }
 
+static void speechTask(void* param) {
+  for (;;) {
+    String* text;
+    if (xQueueReceive(speechQueueHandle, &text, portMAX_DELAY) != pdTRUE) continue;
+    uint32_t start = speechWritten.load(std::memory_order_relaxed);
+    uint32_t startMs = millis();
+    espeak.say(text->c_str());
+    ttsOut.flush();
+    delete text;
+
+    uint32_t end = speechWritten.load(std::memory_order_relaxed);
+    uint32_t done = utterancesDone.load(std::memory_order_relaxed);
+    utteranceEnds[done % TTS_MAX_QUEUED] = end;
+    utterancesDone.store(done + 1, std::memory_order_release);
+    Serial.printf("TTS: %u ms of speech ready after %u ms\n",
+                  (uint32_t)((uint64_t)(end - start) * 1000 / SAMPLE_RATE), millis() - startMs);
+  }
+}
+
 void initTTS() {
+  speechRing = (int16_t*)ps_malloc(TTS_RING_SAMPLES * sizeof(int16_t));
+  speechQueueHandle = xQueueCreate(TTS_MAX_QUEUED, sizeof(String*));
+  if (!speechRing || !speechQueueHandle) {
+    Serial.println("ERROR: Failed to allocate the speech ring!");
+    return;
+  }
+
   // Register empty config file — eSpeak's LoadConfig() tries to open /mem/data/config
   // which doesn't exist in the in-memory PROGMEM filesystem, causing a harmless warning.
   espeak.add("/mem/data/config", "", 0);
@@ -199,52 +275,41 @@ void initTTS() {
   } else {
     Serial.println("ERROR: eSpeak NG init failed!");
   }
+  xTaskCreatePinnedToCore(speechTask, "speech", TTS_TASK_STACK, NULL,
+                          TTS_TASK_PRIORITY, &speechTaskHandle, TTS_TASK_CORE);
 }
 
-void sayText(const char* text) {
-  String processed = sanitizeForTTS(String(text));
-  Serial.printf("TTS: %s\n", processed.c_str());
-  espeak.say(processed.c_str());
-  ttsOut.flush();
+int speechQueue(const String& text) {
+  if (!speechRing) return -1;
+  String* processed = new String(sanitizeForTTS(text));
+  Serial.printf("TTS: %s\n", processed->c_str());
+  int ticket = utterancesQueued++;
+  xQueueSend(speechQueueHandle, &processed, portMAX_DELAY);
+  return ticket;
 }
 
-void playTone(int frequency, int duration) {
-  int totalSamples = (SAMPLE_RATE * duration) / 1000;
-  int16_t buffer[256];
-  int bufIndex = 0;
-
-  int amplitude = (32767 * toneVolumePercent) / 100;
-  for (int i = 0; i < totalSamples; i++) {
-    float t = (float)i / SAMPLE_RATE;
-    int16_t value = (int16_t)(amplitude * sin(2 * PI * frequency * t));
-    buffer[bufIndex++] = value;
-
-    if (bufIndex >= 256) {
-      i2sWrite(buffer, bufIndex);
-      bufIndex = 0;
+void speechPlay(int ticket) {
+  if (ticket < 0) return;
+  uint32_t waitStart = 0;
+  for (;;) {
+    // Written first: if the utterance is still going, all of it is ours
+    uint32_t written = speechWritten.load(std::memory_order_acquire);
+    bool done = (int32_t)(utterancesDone.load(std::memory_order_acquire) - (uint32_t)ticket) > 0;
+    uint32_t end = done ? utteranceEnds[ticket % TTS_MAX_QUEUED] : written;
+    uint32_t r = speechRead.load(std::memory_order_relaxed);
+    if (end == r) {
+      if (done) break;
+      if (!waitStart) waitStart = millis();
+      vTaskDelay(1);
+      continue;
     }
-  }
-
-  // Write remaining samples
-  if (bufIndex > 0) {
-    i2sWrite(buffer, bufIndex);
-  }
-}
-
-void playVoiceMessage(const char* message) {
-  sayText(message);
-}
-
-void speakPreMessage() {
-  if (preMessage.length() > 0) {
-    String expanded = expandMacros(preMessage);
-    sayText(expanded.c_str());
-  }
-}
-
-void speakPostMessage() {
-  if (postMessage.length() > 0) {
-    String expanded = expandMacros(postMessage);
-    sayText(expanded.c_str());
+    if (waitStart) {
+      speechStarvedMs += millis() - waitStart;
+      waitStart = 0;
+    }
+    uint32_t offset = r & SPEECH_RING_MASK;
+    uint32_t n = min(min(end - r, (uint32_t)512), TTS_RING_SAMPLES - offset);
+    i2sWrite(&speechRing[offset], n);
+    speechRead.store(r + n, std::memory_order_release);
   }
 }
@@ -4,18 +4,18 @@
 #include <Arduino.h>
 
 // Forward declare for i2sWrite dependency
-void i2sWrite(int16_t* data, size_t samples);
+void i2sWrite(const int16_t* data, size_t samples);
 
-// TTS functions
+// TTS functions. eSpeak runs on its own task into a PSRAM ring; the TX task
+// (tx.h) queues a job's utterances before keying up and plays them in the
+// same order, each as soon as its turn comes.
 void initTTS();
-void sayText(const char* text);
-void playTone(int frequency, int duration);
-void playVoiceMessage(const char* message);
+int speechQueue(const String& text);  // Starts synthesizing; returns its ticket
+void speechPlay(int ticket);          // Streams it to I2S (waiting on synthesis if need be)
+extern uint32_t speechStarvedMs;
 
 // Message helpers
 String expandMacros(const String &text);
-void speakPreMessage();
-void speakPostMessage();
 
 // Text processing
 String sanitizeForTTS(String text);
@@ -0,0 +1,215 @@
+#include "tx.h"
+#include "radio.h"
+#include "tts.h"
+#include "slots.h"
+#include "earcon.h"
+#include <atomic>
+
+static QueueHandle_t txQueue = nullptr;
+static TaskHandle_t txTaskHandle = nullptr;
+static std::atomic<int> txPending(0);  // Submitted and not yet finished
+
+TxStatus txStatus = {};
+
+static const char* const TX_STEP_NAMES[] = {"speech", "silence", "slot", "recording", "render", "earcon"};
+
+// ==================== Steps ====================
+
+static void playReader(SlotReader& reader) {
+  int16_t buffer[SLOT_READ_SAMPLES];
+  int chunkSize;
+  while ((chunkSize = readSlotBlock(reader, buffer)) > 0) {
+    i2sWrite(buffer, chunkSize);
+  }
+  closeSlotReader(reader);
+}
+
+// Keyed silence, written out like any other audio so the stream never runs dry
+static void playSilence(int ms) {
+  static const int16_t zeros[256] = {};
+  int left = (int)((int64_t)SAMPLE_RATE * ms / 1000);
+  while (left > 0) {
+    int n = min(left, 256);
+    i2sWrite(zeros, n);
+    left -= n;
+  }
+}
+
+static void runStep(const TxStep& step) {
+  SlotReader reader;
+  switch (step.type) {
+    case TX_SPEECH:
+      speechPlay(step.value);  // Queued (and likely synthesized) before key-up
+      break;
+    case TX_SILENCE:
+      playSilence(step.ms);
+      break;
+    case TX_SLOT:
+      if (!openSlotReader(reader, step.value)) break;  // Emptied since the job started
+      Serial.printf("Playing slot %d (%d samples)\n", step.value + 1, slots[step.value].sampleCount);
+      playReader(reader);
+      printAdpcmStats();
+      break;
+    case TX_RECORDING:
+      // The recording lives in the slot it was saved to (or, if there was
+      // no slot to save it to, still in the recording's own chunks; loop()
+      // starts no new recording until this job is done)
+      if (openSlotReader(reader, step.value) || openRecordingReader(reader)) {
+        playReader(reader);
+      }
+      break;
+    case TX_RENDER:
+      step.render();
+      break;
+    case TX_EARCON:
+      playEarcon(step.value);
+      break;
+  }
+}
+
+static void runJob(TxJob* job) {
+  txStatus.step = 0;
+  txStatus.steps = job->stepCount;
+  txStatus.samplesBase = i2sStats.txSamples;
+  txStatus.job = job->name;
+
+  // Lookups and speech synthesis run during the wait, not after it
+  uint32_t startMs = millis();
+  if (job->prepare) {
+    job->prepare(job);
+    txStatus.steps = job->stepCount;
+  }
+
+  // Start synthesizing every utterance now, in order: the first ones are
+  // made while we wait and key up, the rest while the steps before them play
+  uint32_t starvedBase = speechStarvedMs;
+  for (int i = 0; i < job->stepCount; i++) {
+    TxStep& step = job->steps[i];
+    if (step.type == TX_SLOT && slots[step.value].sampleCount == 0) {
+      Serial.printf("Slot %d is empty\n", step.value + 1);
+      step.type = TX_SPEECH;
+      step.text = "no recording";
+    }
+    if (step.type == TX_SPEECH) step.value = speechQueue(step.text);
+  }
+  int32_t waitLeft = job->waitMs - (int32_t)(millis() - startMs);
+  if (waitLeft > 0) delay(waitLeft);
+
+  pttOn();
+  delay(job->keyupMs);
+  for (int i = 0; i < job->stepCount; i++) {
+    txStatus.step = i + 1;
+    Serial.printf("TX %s: step %d/%d (%s)\n", job->name, i + 1, job->stepCount, TX_STEP_NAMES[job->steps[i].type]);
+    runStep(job->steps[i]);
+  }
+  i2sStreamEnd();
+  delay(job->tailMs);
+  pttOff();
+
+  Serial.printf("TX %s: done, %u ms of audio, %u ms waiting on speech, %u bytes of stack never used\n", job->name,
+                (uint32_t)((uint64_t)(i2sStats.txSamples - txStatus.samplesBase) * 1000 / SAMPLE_RATE),
+                speechStarvedMs - starvedBase, (uint32_t)uxTaskGetStackHighWaterMark(NULL));
+  txStatus.job = nullptr;
+  txStatus.completed++;
+}
+
+static void txTask(void* param) {
+  for (;;) {
+    TxJob* job;
+    if (xQueueReceive(txQueue, &job, portMAX_DELAY) != pdTRUE) continue;
+    runJob(job);
+    delete job;
+    txPending--;
+  }
+}
+
+void initTx() {
+  txQueue = xQueueCreate(TX_QUEUE_LEN, sizeof(TxJob*));
+  xTaskCreatePinnedToCore(txTask, "tx", TX_TASK_STACK, NULL,
+                          TX_TASK_PRIORITY, &txTaskHandle, TX_TASK_CORE);
+  Serial.printf("TX task started on core %d (%d job queue)\n", TX_TASK_CORE, TX_QUEUE_LEN);
+}
+
+bool txBusy() {
+  return txPending > 0;
+}
+
+int txQueued() {
+  return txQueue ? uxQueueMessagesWaiting(txQueue) : 0;
+}
+
+// ==================== Building Jobs ====================
+
+TxJob* txNewJob(const char* name, int waitMs, int keyupMs, int tailMs) {
+  TxJob* job = new TxJob();
+  job->name = name;
+  job->waitMs = waitMs;
+  job->keyupMs = keyupMs;
+  job->tailMs = tailMs;
+  job->prepare = nullptr;
+  job->stepCount = 0;
+  return job;
+}
+
+static TxStep* addStep(TxJob* job, TxStepType type) {
+  if (job->stepCount >= TX_MAX_STEPS) {
+    Serial.printf("TX %s: too many steps, dropping one\n", job->name);
+    return nullptr;
+  }
+  TxStep* step = &job->steps[job->stepCount++];
+  step->type = type;
+  step->value = 0;
+  step->ms = 0;
+  step->render = nullptr;
+  return step;
+}
+
+void txSpeech(TxJob* job, const String& text) {
+  TxStep* step = addStep(job, TX_SPEECH);
+  if (step) step->text = text;
+}
+
+void txSilence(TxJob* job, int ms) {
+  TxStep* step = addStep(job, TX_SILENCE);
+  if (step) step->ms = ms;
+}
+
+void txSlot(TxJob* job, int slotIndex) {
+  TxStep* step = addStep(job, TX_SLOT);
+  if (step) step->value = slotIndex;
+}
+
+void txRecording(TxJob* job, int slotIndex) {
+  TxStep* step = addStep(job, TX_RECORDING);
+  if (step) step->value = slotIndex;
+}
+
+void txRender(TxJob* job, void (*render)()) {
+  TxStep* step = addStep(job, TX_RENDER);
+  if (step) step->render = render;
+}
+
+void txEarcon(TxJob* job, int earcon) {
+  TxStep* step = addStep(job, TX_EARCON);
+  if (step) step->value = earcon;
+}
+
+void txPreMessage(TxJob* job) {
+  if (preMessage.length() > 0) txSpeech(job, expandMacros(preMessage));
+}
+
+void txPostMessage(TxJob* job) {
+  if (postMessage.length() > 0) txSpeech(job, expandMacros(postMessage));
+}
+
+bool txSubmit(TxJob* job) {
+  txPending++;
+  if (!txQueue || xQueueSend(txQueue, &job, 0) != pdTRUE) {
+    txPending--;
+    txStatus.dropped++;
+    Serial.printf("TX %s: queue full, dropped\n", job->name);
+    delete job;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef TX_H
+#define TX_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Transmit engine: everything that goes out over the air is queued as a
+// job of steps and played by the TX task, which owns PTT and keys it once
+// around the whole job. loop() - and the web server and captive portal with
+// it - carries on meanwhile; it only holds off recording while a job is
+// queued or on the air (the SA868 is half duplex).
+
+enum TxStepType : uint8_t {
+  TX_SPEECH,      // text, through eSpeak (value = its speechQueue() ticket once queued)
+  TX_SILENCE,     // ms, still keyed
+  TX_SLOT,        // Slot value, or "no recording" if it is empty
+  TX_RECORDING,   // Slot value, or the unsaved last recording if there is no such slot
+  TX_RENDER,      // render() writes its own audio (test audio, packets)
+  TX_EARCON,      // Pre-rendered feedback earcon value (earcon.h)
+};
+
+struct TxStep {
+  TxStepType type;
+  int value;
+  int ms;
+  String text;
+  void (*render)();
+};
+
+struct TxJob {
+  const char* name;
+  int waitMs;         // Before keying up (lets the caller's radio / repeater drop first); prepare() and synthesis overlap it
+  int keyupMs;        // PTT to first audio
+  int tailMs;         // Last audio to PTT off
+  void (*prepare)(TxJob* job);  // Run before keying up; may add steps (slow lookups)
+  int stepCount;
+  TxStep steps[TX_MAX_STEPS];
+};
+
+// What the TX task is doing, for /status
+struct TxStatus {
+  const char* job;            // On the air (or waiting to key up), nullptr = idle
+  int step;                   // Step being played, 1 to steps
+  int steps;
+  uint32_t samplesBase;       // i2sStats.txSamples when the job started
+  uint32_t completed;         // Jobs since boot
+  uint32_t dropped;           // Jobs refused because the queue was full
+};
+extern TxStatus txStatus;
+
+void initTx();
+bool txBusy();              // A job is queued or on the air
+int txQueued();             // Jobs waiting behind the current one
+
+// Build a job, add its steps, submit it. The TX task frees it once played.
+TxJob* txNewJob(const char* name, int waitMs, int keyupMs, int tailMs);
+void txSpeech(TxJob* job, const String& text);
+void txSilence(TxJob* job, int ms);
+void txSlot(TxJob* job, int slotIndex);
+void txRecording(TxJob* job, int slotIndex);
+void txRender(TxJob* job, void (*render)());
+void txEarcon(TxJob* job, int earcon);
+void txPreMessage(TxJob* job);   // Macros expanded now, not when played
+void txPostMessage(TxJob* job);
+bool txSubmit(TxJob* job);
+
+#endif // TX_H
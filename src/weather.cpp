@@ -2,6 +2,7 @@
 #include "config.h"
 #include "tts.h"
 #include "radio.h"
+#include "tx.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 
@@ -133,14 +134,17 @@ String fetchWeatherReport() {
   return report;
 }
 
-void speakWeather() {
+// Runs on the TX task before it keys up, so a slow fetch is no dead air
+static void prepareWeather(TxJob* job) {
   String report = fetchWeatherReport();
   Serial.printf("Weather report: %s\n", report.c_str());
-  pttOn();
-  delay(600);
-  speakPreMessage();
-  sayText(("Weather report, " + report).c_str());
-  speakPostMessage();
-  delay(1000);
-  pttOff();
+  txPreMessage(job);
+  txSpeech(job, "Weather report, " + report);
+  txPostMessage(job);
+}
+
+void speakWeather() {
+  TxJob* job = txNewJob("weather", REPLY_WAIT_MS, 600, 1000);
+  job->prepare = prepareWeather;
+  txSubmit(job);
 }
@@ -1,8 +1,17 @@
 #include "web.h"
 #include "config.h"
 #include "rtc.h"
+#include "slots.h"
+#include "dsp.h"
+#include "arena.h"
+#include "radio.h"
+#include "ctcss.h"
+#include "dcs.h"
+#include "capture.h"
+#include "tx.h"
 #include <WiFi.h>
 #include <time.h>
+#include <esp_timer.h>
 
 void handleRoot() {
   String html = "<!DOCTYPE html><html><head><title>Radio Parrot</title>";
@@ -40,12 +49,33 @@ void handleRoot() {
   html += "<label>Frequency (MHz):</label><input name='freq' value='" + radioFreq + "' placeholder='451.0000'>";
   html += "<label>TX CTCSS (0000=none):</label><input name='txctcss' value='" + radioTxCTCSS + "' placeholder='0000'>";
   html += "<label>RX CTCSS (0000=none):</label><input name='rxctcss' value='" + radioRxCTCSS + "' placeholder='0000'>";
+  html += "<label><input type='checkbox' name='ctcssdec' value='1'" + String(ctcssDecode ? " checked" : "") + "> Identify the caller's CTCSS tone or DCS code (set RX CTCSS to 0000)</label><br>";
   html += "<label>Squelch (0-8):</label><input name='squelch' type='number' min='0' max='8' value='" + String(radioSquelch) + "'>";
 
   // Audio settings
   html += "<h2>Audio Settings</h2>";
   html += "<label>Voice Volume (0-100%):</label><input name='samvol' type='number' min='0' max='100' value='" + String(samVolumePercent) + "'>";
   html += "<label>Tone Volume (0-100%):</label><input name='tonevol' type='number' min='0' max='100' value='" + String(toneVolumePercent) + "'>";
+  html += "<label><input type='checkbox' name='dcblock' value='1'" + String(filterDcBlock ? " checked" : "") + "> Remove DC offset</label><br>";
+  html += "<label><input type='checkbox' name='highpass' value='1'" + String(filterHighpass ? " checked" : "") + "> Filter out CTCSS tones (" + String(FILTER_HIGHPASS_HZ) + " Hz high-pass)</label><br>";
+  html += "<label><input type='checkbox' name='deemph' value='1'" + String(filterDeemphasis ? " checked" : "") + "> De-emphasis (" + String(FILTER_DEEMPHASIS_US) + " us)</label><br>";
+  html += "<label>Pre-roll (0-" + String(PREROLL_MS_MAX) + " ms before squelch opens):</label><input name='preroll' type='number' min='0' max='" + String(PREROLL_MS_MAX) + "' value='" + String(prerollMs) + "'>";
+
+  // Recording storage
+  html += "<h2>Recordings</h2>";
+  html += "<label>Longest recording (1-" + String(MAX_RECORDING_SECONDS_LIMIT) + " seconds):</label><input name='maxrec' type='number' min='1' max='" + String(MAX_RECORDING_SECONDS_LIMIT) + "' value='" + String(maxRecordSeconds) + "'>";
+  html += "<label>Store recordings at:</label><select name='rate'>";
+  for (int factor = 1; factor <= RESAMPLE_MAX_FACTOR; factor++) {
+    html += "<option value='" + String(factor) + "'" + String(storageDecimation == factor ? " selected" : "") + ">" +
+            String(SAMPLE_RATE / factor) + " Hz" + String(factor > 1 ? " (" + String(factor) + "x more recordings)" : "") + "</option>";
+  }
+  html += "</select>";
+  html += "<label>When memory is full, drop:</label><select name='evict'>";
+  html += "<option value='0'" + String(slotEvictPolicy == EVICT_OLDEST ? " selected" : "") + ">Oldest recording first</option>";
+  html += "<option value='1'" + String(slotEvictPolicy == EVICT_LONGEST ? " selected" : "") + ">Longest recording first</option>";
+  html += "</select>";
+  html += "<label><input type='checkbox' name='vad' value='1'" + String(vadTrimEnabled ? " checked" : "") + "> Trim dead carrier and squelch tail</label><br>";
+  html += "<label><input type='checkbox' name='adpcm' value='1'" + String(slotCompression ? " checked" : "") + "> Compress stored recordings (ADPCM, 4x more recordings)</label>";
 
   // Pre/post messages
   html += "<h2>Message Wrapping</h2>";
@@ -65,6 +95,7 @@ void handleRoot() {
   html += "<code>{slot}</code> next slot #, ";
   html += "<code>{slots_used}</code> used slots, ";
   html += "<code>{slots_total}</code> total slots, ";
+  html += "<code>{unit}</code> caller's MDC1200 unit ID, ";
   html += "<code>{freq}</code> frequency, ";
   html += "<code>{uptime}</code> uptime, ";
   html += "<code>{ip}</code> IP address";
@@ -74,6 +105,18 @@ void handleRoot() {
   html += "<h2>DTMF # Message</h2>";
   html += "<label>Text to speak on DTMF # (empty to disable):</label>";
   html += "<textarea name='hashmsg' rows='3' style='width:100%'>" + dtmfHashMessage + "</textarea>";
+  html += "<label>Admin PIN (empty to disable DTMF admin commands):</label>";
+  html += "<input name='adminpin' type='password' inputmode='numeric' placeholder='" + String(dtmfAdminPin.length() > 0 ? "Set - enter a new PIN to change it" : "1234") + "'>";
+  html += "<label><input type='checkbox' name='clearpin' value='1'> Clear the admin PIN</label><br>";
+  html += "<small>D&lt;pin&gt;*1# clears recordings, D&lt;pin&gt;*2n# / *3n# pin/unpin slot n, D&lt;pin&gt;*9# reboots</small><br>";
+  html += "<label><input type='checkbox' name='dtmflow' value='1'" + String(dtmfLowRate ? " checked" : "") + "> Decode DTMF at 7350 Hz (less CPU while recording)</label><br>";
+
+  // AX.25 telemetry beacon
+  html += "<h2>Telemetry Beacon</h2>";
+  html += "<label>Callsign (with SSID, empty to disable):</label>";
+  html += "<input name='callsign' value='" + beaconCallsign + "' placeholder='N0CALL-7'>";
+  html += "<label>Beacon every (0-" + String(BEACON_INTERVAL_MAX_MIN) + " minutes, 0 = never):</label><input name='beaconmin' type='number' min='0' max='" + String(BEACON_INTERVAL_MAX_MIN) + "' value='" + String(beaconIntervalMin) + "'>";
+  html += "<small>Sends battery, RSSI, slots used and uptime as an APRS telemetry packet (AFSK1200)</small><br>";
 
   // Time & timezone
   html += "<h2>Time &amp; Timezone</h2>";
@@ -93,6 +136,29 @@ void handleRoot() {
   html += "<br><br><input type='submit' value='Save & Reboot'>";
   html += "</form>";
 
+  // Stored recordings (pinned slots are never evicted or overwritten)
+  html += "<h2>Stored Recordings</h2>";
+  html += "<p>" + String(usedSlotCount()) + " recordings, " + String(arenaFreeBytes() / 1024) + " KB free</p><ul>";
+  for (int i = 0; i < MAX_SLOTS; i++) {
+    if (slots[i].sampleCount == 0) continue;
+    html += "<li>Slot " + String(i + 1) + ": " + String((float)slots[i].sampleCount * slots[i].decimation / SAMPLE_RATE, 1) + " s";
+    if (slots[i].trimmedSamples > 0) {
+      html += " (" + String((float)slots[i].trimmedSamples / SAMPLE_RATE, 1) + " s trimmed)";
+    }
+    if (slots[i].decimation > 1) {
+      html += " (" + String(SAMPLE_RATE / slots[i].decimation) + " Hz)";
+    }
+    if (slots[i].unitId >= 0) {
+      char unit[8];
+      snprintf(unit, sizeof(unit), "%04X", slots[i].unitId & 0xFFFF);
+      html += " (unit " + String(unit) + ")";
+    }
+    html += String(slots[i].format == SLOT_ADPCM ? " (ADPCM) " : " ");
+    html += "<form action='/pin' method='POST' style='display:inline'><input type='hidden' name='slot' value='" + String(i + 1) + "'>";
+    html += "<button name='on' value='" + String(slots[i].pinned ? "0'>unpin" : "1'>pin") + "</button></form></li>";
+  }
+  html += "</ul>";
+
   // Link to pins page
   html += "<p><a href='/pins'>Configure Pins</a></p>";
 
@@ -174,6 +240,7 @@ void handleSave() {
   String newSquelch = server.arg("squelch");
   String newSamVol = server.arg("samvol");
   String newToneVol = server.arg("tonevol");
+  String newPreroll = server.arg("preroll");
   bool newTestMode = server.hasArg("testmode");
 
   preferences.begin("parrot", false);
@@ -208,10 +275,38 @@ void handleSave() {
   if (newToneVol.length() > 0) {
     preferences.putInt("tonevol", constrain(newToneVol.toInt(), 0, 100));
   }
+  if (newPreroll.length() > 0) {
+    preferences.putInt("preroll", constrain(newPreroll.toInt(), 0, PREROLL_MS_MAX));
+  }
+  if (server.arg("maxrec").length() > 0) {
+    preferences.putInt("maxrec", constrain(server.arg("maxrec").toInt(), 1, MAX_RECORDING_SECONDS_LIMIT));
+  }
+  if (server.hasArg("rate")) {
+    preferences.putInt("rate", constrain(server.arg("rate").toInt(), 1, RESAMPLE_MAX_FACTOR));
+  }
+  if (server.hasArg("evict")) {
+    preferences.putInt("evict", server.arg("evict").toInt() == EVICT_LONGEST ? EVICT_LONGEST : EVICT_OLDEST);
+  }
+  preferences.putBool("adpcm", server.hasArg("adpcm"));
+  preferences.putBool("vad", server.hasArg("vad"));
+  preferences.putBool("dcblock", server.hasArg("dcblock"));
+  preferences.putBool("highpass", server.hasArg("highpass"));
+  preferences.putBool("deemph", server.hasArg("deemph"));
+  preferences.putBool("ctcssdec", server.hasArg("ctcssdec"));
   preferences.putBool("testmode", newTestMode);
   preferences.putString("hashmsg", server.arg("hashmsg"));
+  if (server.hasArg("clearpin")) {
+    preferences.putString("adminpin", "");
+  } else if (server.arg("adminpin").length() > 0) {
+    preferences.putString("adminpin", server.arg("adminpin"));
+  }
+  preferences.putBool("dtmflow", server.hasArg("dtmflow"));
   preferences.putString("premsg", server.arg("premsg"));
   preferences.putString("postmsg", server.arg("postmsg"));
+  preferences.putString("callsign", server.arg("callsign"));
+  if (server.arg("beaconmin").length() > 0) {
+    preferences.putInt("beaconmin", constrain(server.arg("beaconmin").toInt(), 0, BEACON_INTERVAL_MAX_MIN));
+  }
   if (server.hasArg("tz")) {
     preferences.putString("tz", server.arg("tz"));
   }
@@ -248,6 +343,22 @@ void handleSave() {
   ESP.restart();
 }
 
+// Last recording / transmission, with I2S glitches counted while it ran
+static String airActivityJson(const AirActivity& activity) {
+  bool active = activity.startUs && !activity.endUs;
+  int64_t endUs = active ? esp_timer_get_time() : activity.endUs;
+  String json = "{";
+  json += "\"count\":" + String(activity.count) + ",";
+  json += "\"started\":" + String((uint32_t)activity.started) + ",";
+  json += "\"start_ms\":" + String((uint32_t)(activity.startUs / 1000)) + ",";
+  json += "\"duration_ms\":" + String(activity.startUs ? (uint32_t)((endUs - activity.startUs) / 1000) : 0) + ",";
+  json += "\"active\":" + String(active ? "true" : "false") + ",";
+  json += "\"rx_overflows\":" + String(active ? i2sStats.rxOverflows - activity.rxOverflowsBase : activity.rxOverflows) + ",";
+  json += "\"tx_underruns\":" + String(active ? i2sStats.txUnderruns - activity.txUnderrunsBase : activity.txUnderruns);
+  json += "}";
+  return json;
+}
+
 void handleStatus() {
   String json = "{";
   json += "\"wifi\":\"" + String((WiFi.status() == WL_CONNECTED) ? "connected" : "disconnected") + "\",";
@@ -265,7 +376,51 @@ void handleStatus() {
   }
   json += "\"tz\":\"" + timezonePosix + "\",";
   json += "\"rtc\":" + String(rtcFound ? "true" : "false") + ",";
-  json += "\"ntp\":" + String(ntpSynced ? "true" : "false");
+  json += "\"ntp\":" + String(ntpSynced ? "true" : "false") + ",";
+  json += "\"slots_used\":" + String(usedSlotCount()) + ",";
+  json += "\"arena_free\":" + String(arenaFreeBytes()) + ",";
+  json += "\"arena_largest\":" + String(arenaLargestFree()) + ",";
+  json += "\"uptime_ms\":" + String((uint32_t)(esp_timer_get_time() / 1000)) + ",";
+  json += "\"i2s\":{";
+  json += "\"rx_overflows\":" + String(i2sStats.rxOverflows) + ",";
+  json += "\"tx_underruns\":" + String(i2sStats.txUnderruns) + ",";
+  json += "\"dma_errors\":" + String(i2sStats.dmaErrors) + ",";
+  json += "\"last_rx_overflow_ms\":" + String((uint32_t)(i2sStats.lastRxOverflowUs / 1000)) + ",";
+  json += "\"last_tx_underrun_ms\":" + String((uint32_t)(i2sStats.lastTxUnderrunUs / 1000)) + ",";
+  json += "\"capture_overflows\":" + String(captureStats.overflows) + ",";
+  json += "\"capture_dropped\":" + String(captureStats.droppedSamples);
+  json += "},";
+  json += "\"filters\":{";
+  json += "\"avg_cycles\":" + String(filterStats.blocks ? (uint32_t)(filterStats.cycles / filterStats.blocks) : 0) + ",";
+  json += "\"max_cycles\":" + String(filterStats.maxCycles) + ",";
+  json += "\"budget_cycles\":" + String(FILTER_CYCLE_BUDGET) + ",";
+  json += "\"over_budget\":" + String(filterStats.overBudget);
+  json += "},";
+  json += "\"ctcss\":{";
+  json += "\"enabled\":" + String(ctcssDecode ? "true" : "false") + ",";
+  json += "\"tone_hz\":" + String(callerCtcss >= 0 ? CTCSS_TONE_TABLE[callerCtcss].hz : 0.0f, 1) + ",";
+  json += "\"code\":" + String(callerCtcss >= 0 ? CTCSS_TONE_TABLE[callerCtcss].code : 0) + ",";
+  char dcsName[5], dcsTwinName[5];
+  dcsCodeName(callerDcs, dcsName);
+  dcsCodeName(callerDcsTwin, dcsTwinName);
+  json += "\"dcs\":\"" + String(dcsName) + "\",";
+  json += "\"dcs_twin\":\"" + String(dcsTwinName) + "\"";
+  json += "},";
+  char unit[8] = "";
+  if (callerUnit >= 0) snprintf(unit, sizeof(unit), "%04X", callerUnit & 0xFFFF);
+  json += "\"caller_unit\":\"" + String(unit) + "\",";
+  const char* txJob = txStatus.job;
+  json += "\"tx\":{";
+  json += "\"job\":\"" + String(txJob ? txJob : "") + "\",";
+  json += "\"step\":" + String(txJob ? txStatus.step : 0) + ",";
+  json += "\"steps\":" + String(txJob ? txStatus.steps : 0) + ",";
+  json += "\"audio_ms\":" + String(txJob ? (uint32_t)((uint64_t)(i2sStats.txSamples - txStatus.samplesBase) * 1000 / SAMPLE_RATE) : 0) + ",";
+  json += "\"queued\":" + String(txQueued()) + ",";
+  json += "\"completed\":" + String(txStatus.completed) + ",";
+  json += "\"dropped\":" + String(txStatus.dropped);
+  json += "},";
+  json += "\"last_recording\":" + airActivityJson(lastRecording) + ",";
+  json += "\"last_transmission\":" + airActivityJson(lastTransmission);
   json += "}";
   server.send(200, "application/json", json);
 }
@@ -303,6 +458,20 @@ void handleSetTime() {
   }
 }
 
+void handlePin() {
+  int slotNum = server.arg("slot").toInt();
+  if (slotNum < 1 || slotNum > MAX_SLOTS) {
+    server.send(400, "text/plain", "Invalid slot");
+    return;
+  }
+  if (!setSlotPinned(slotNum - 1, server.arg("on") == "1")) {
+    server.send(400, "text/plain", "Empty slot");
+    return;
+  }
+  server.sendHeader("Location", "/", true);
+  server.send(302, "text/plain", "");
+}
+
 void handlePins() {
   String html = "<!DOCTYPE html><html><head><title>Pin Configuration</title>";
   html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
@@ -368,11 +537,21 @@ void initWiFi() {
   radioFreq = preferences.getString("freq", "451.0000");
   radioTxCTCSS = preferences.getString("txctcss", "0000");
   radioRxCTCSS = preferences.getString("rxctcss", "0000");
+  ctcssDecode = preferences.getBool("ctcssdec", false);
   radioSquelch = preferences.getInt("squelch", 4);
 
   // Audio settings
   samVolumePercent = preferences.getInt("samvol", 25);
   toneVolumePercent = preferences.getInt("tonevol", 12);
+  slotEvictPolicy = preferences.getInt("evict", EVICT_OLDEST);
+  slotCompression = preferences.getBool("adpcm", true);
+  vadTrimEnabled = preferences.getBool("vad", true);
+  filterDcBlock = preferences.getBool("dcblock", true);
+  filterHighpass = preferences.getBool("highpass", true);
+  filterDeemphasis = preferences.getBool("deemph", false);
+  prerollMs = constrain(preferences.getInt("preroll", PREROLL_MS_DEFAULT), 0, PREROLL_MS_MAX);
+  storageDecimation = constrain(preferences.getInt("rate", STORAGE_DECIMATION_DEFAULT), 1, RESAMPLE_MAX_FACTOR);
+  maxRecordSeconds = constrain(preferences.getInt("maxrec", MAX_RECORDING_SECONDS), 1, MAX_RECORDING_SECONDS_LIMIT);
 
   // Pin configuration
   pinPTT = preferences.getInt("pinPTT", 33);
@@ -388,8 +567,12 @@ void initWiFi() {
   // Testing mode (default ON for safety)
   testingMode = preferences.getBool("testmode", true);
   dtmfHashMessage = preferences.getString("hashmsg", "");
+  dtmfAdminPin = preferences.getString("adminpin", "");
+  dtmfLowRate = preferences.getBool("dtmflow", false);
   preMessage = preferences.getString("premsg", "");
   postMessage = preferences.getString("postmsg", "");
+  beaconCallsign = preferences.getString("callsign", "");
+  beaconIntervalMin = constrain(preferences.getInt("beaconmin", 0), 0, BEACON_INTERVAL_MAX_MIN);
   timezonePosix = preferences.getString("tz", "");
 
   preferences.end();
@@ -449,6 +632,7 @@ void initWiFi() {
   server.on("/savepins", HTTP_POST, handleSavePins);
   server.on("/status", handleStatus);
   server.on("/settime", HTTP_POST, handleSetTime);
+  server.on("/pin", HTTP_POST, handlePin);
 
   // Captive portal - redirect all unknown URLs to root
   server.onNotFound([]() {
@@ -19,6 +19,7 @@ void handleRoot();
 void handleSave();
 void handleStatus();
 void handleSetTime();
+void handlePin();
 void handlePins();
 void handleSavePins();
 
@@ -0,0 +1,53 @@
+#ifndef TEST_SIGNAL_H
+#define TEST_SIGNAL_H
+
+// Shared by the native test suites: test audio, synthetic signals and timing.
+// Header only so each suite stays a single translation unit.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <radio_test_audio.h>
+
+#define TEST_BENCH_ITERATIONS 2000
+#define TEST_BENCH_RUNS 5            // Timings take the best run
+
+static inline void loadTestAudio(int16_t* dest, int count, int offset) {
+  for (int i = 0; i < count; i++) {
+    dest[i] = pgm_read_word(&radioTestAudio[(offset + i) % RADIO_TEST_SAMPLES]);
+  }
+}
+
+static inline int16_t clip16(int32_t x) {
+  return (int16_t)constrain(x, (int32_t)-32768, (int32_t)32767);
+}
+
+// Near-Gaussian white noise with unit rms (sum of 4 uniforms on +/-0.5,
+// which have an rms of 0.577), from a fixed LCG so every run is the same
+static inline float testNoise(uint32_t& seed) {
+  float sum = 0;
+  for (int k = 0; k < 4; k++) {
+    seed = seed * 1664525 + 1013904223;
+    sum += (float)(seed >> 8) / (1 << 24) - 0.5f;
+  }
+  return sum * 1.732f;
+}
+
+static inline float dbToGain(float db) {
+  return powf(10.0f, db / 20.0f);
+}
+
+// Wall-clock timing on the host: only the ratio between two paths means much
+static inline int64_t benchNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void printBenchResult(const char* name, int64_t ns, int iterations, int samples) {
+  char line[128];
+  double perBlock = (double)ns / iterations;
+  snprintf(line, sizeof(line), "%-28s %9.0f ns/block  %6.2f ns/sample", name, perBlock, perBlock / samples);
+  TEST_MESSAGE(line);
+}
+
+#endif // TEST_SIGNAL_H
@@ -0,0 +1,41 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Just enough of the Arduino core for the DSP and modem sources (dsp, dtmf,
+// fsk, mdc, ax25) to build on the host, for the native test environment.
+// Nothing here touches hardware; anything that does stays out of that build.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include <esp_attr.h>  // The ESP32 core pulls it in too
+
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::min;
+using std::max;
+
+// The String operations the sources use (config.h declares String globals)
+class String {
+ public:
+  String() {}
+  String(const char* text) : text_(text ? text : "") {}
+  String& operator+=(const String& other) { text_ += other.text_; return *this; }
+  String& operator+=(const char* other) { text_ += other; return *this; }
+  String& operator+=(char c) { text_ += c; return *this; }
+  const char* c_str() const { return text_.c_str(); }
+  unsigned length() const { return text_.size(); }
+
+ private:
+  std::string text_;
+};
+
+#endif // ARDUINO_H
@@ -0,0 +1,8 @@
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+// Host builds have no IRAM: the placement attributes are no-ops
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // ESP_ATTR_H
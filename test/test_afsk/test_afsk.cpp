@@ -0,0 +1,138 @@
+// Host loopback for AX.25 over AFSK1200: a telemetry frame through the
+// real encoder (so a sender clock offset moves tones and bit rate
+// together) at -15dBFS, 0.1s into a second of white noise and/or the test
+// audio, optionally through the capture path's de-emphasis, into the
+// decoder. It has to come out byte for byte. Run with
+// `pio test -e native -f test_afsk`.
+
+#include <unity.h>
+#include "config.h"
+#include "dsp.h"
+#include "ax25.h"
+#include "test_signal.h"
+
+#define TEST_BLOCK 256
+#define TEST_LEVEL 6000
+#define TEST_LEAD (SAMPLE_RATE / 10)
+#define TEST_SAMPLES SAMPLE_RATE
+#define TEST_INFO "T#042,087,041,123,005,017,10100000"
+
+void setUp() {}
+void tearDown() {}
+
+struct AfskCase {
+  bool frame;        // false = noise/speech only, nothing may decode
+  float snrDb;       // Frame over white noise; 99 = no noise
+  int speechGain;    // Test audio mixed in at this gain; 0 = none
+  float clockPct;    // Sender's bit rate and tones off by this much
+  bool deemphasis;   // Twist the tones like an un-pre-emphasised sender (about 5dB less 2200 than 1200Hz)
+};
+
+static uint8_t frame[AX25_MAX_FRAME];
+static int frameLength;
+
+static void loadAfsk(const AfskCase& c, int16_t* dest, uint32_t seed) {
+  static AfskEncoder encoder;
+  memset(dest, 0, TEST_SAMPLES * sizeof(int16_t));
+  if (c.frame) {
+    float scale = 1.0f + c.clockPct / 100.0f;
+    afskBegin(encoder, frame, frameLength, AFSK_TXDELAY_FLAGS, AFSK_TAIL_FLAGS, TEST_LEVEL, SAMPLE_RATE / scale);
+    int rendered = TEST_LEAD, n;
+    while ((n = afskRender(encoder, dest + rendered, TEST_SAMPLES - rendered)) > 0) rendered += n;
+    TEST_ASSERT_TRUE_MESSAGE(rendered < TEST_SAMPLES, "burst longer than the test signal");
+  }
+  if (c.deemphasis) {
+    Biquad twist;
+    biquadDeemphasis(twist, FILTER_DEEMPHASIS_US, FILTER_DEEMPHASIS_ZERO_HZ);
+    biquadProcess(&twist, 1, dest, TEST_SAMPLES);
+  }
+
+  float noiseRms = c.snrDb < 99 ? TEST_LEVEL / 1.414f / dbToGain(c.snrDb) : 0;
+  if (!c.frame && !c.speechGain) noiseRms = TEST_LEVEL;
+  for (int i = 0; i < TEST_SAMPLES; i++) {
+    float x = dest[i];
+    if (c.speechGain) {
+      x += (float)(int16_t)pgm_read_word(&radioTestAudio[i % RADIO_TEST_SAMPLES]) * c.speechGain;
+    }
+    if (noiseRms > 0) x += noiseRms * testNoise(seed);
+    dest[i] = clip16((int32_t)x);
+  }
+}
+
+// Runs one case; returns the frames decoded, and whether the last one matched
+static int runAfskCase(const AfskCase& c, bool& match, uint32_t seed = 12345) {
+  static Ax25Decoder packet;
+  static int16_t signal[TEST_SAMPLES];
+  ax25Init(packet, SAMPLE_RATE);
+  loadAfsk(c, signal, seed);
+  for (int offset = 0; offset < TEST_SAMPLES; offset += TEST_BLOCK) {
+    ax25Process(packet, signal + offset, min(TEST_BLOCK, TEST_SAMPLES - offset));
+  }
+  match = packet.lastLength == frameLength && memcmp(packet.last, frame, frameLength) == 0;
+  return packet.frames;
+}
+
+static void assertDecodes(const AfskCase& c) {
+  bool match;
+  TEST_ASSERT_EQUAL_INT(1, runAfskCase(c, match));
+  TEST_ASSERT_TRUE(match);
+}
+
+static void test_tnc2_format() {
+  char text[AX25_MAX_FRAME + 80];
+  TEST_ASSERT_TRUE(ax25Format(frame, frameLength, text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("N0CALL-7>" BEACON_DEST "," BEACON_PATH ":" TEST_INFO, text);
+}
+
+static void test_clean() {
+  assertDecodes({true, 99, 0, 0, false});
+}
+
+static void test_snr() {
+  assertDecodes({true, 12, 0, 0, false});
+  assertDecodes({true, 6, 0, 0, false});
+}
+
+static void test_deemphasis() {
+  assertDecodes({true, 20, 0, 0, true});
+}
+
+static void test_clock_offset() {
+  assertDecodes({true, 20, 0, 2.0f, false});
+  assertDecodes({true, 20, 0, -2.0f, false});
+  assertDecodes({true, 6, 0, 2.0f, false});
+  assertDecodes({true, 6, 0, -2.0f, false});
+}
+
+static void test_noise_and_speech_only() {
+  bool match;
+  TEST_ASSERT_EQUAL_INT(0, runAfskCase({false, 99, 0, 0, false}, match));
+  TEST_ASSERT_EQUAL_INT(0, runAfskCase({false, 99, 1, 0, false}, match));
+}
+
+// Not a pass/fail limit: how far below 6dB it still holds on, for the log
+static void test_snr_sweep() {
+  char line[64];
+  for (int snr = 8; snr >= 0; snr -= 2) {
+    int decoded = 0;
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+      bool match;
+      if (runAfskCase({true, (float)snr, 0, 0, false}, match, seed) == 1 && match) decoded++;
+    }
+    snprintf(line, sizeof(line), "SNR %d dB: %2d/20 frames decoded", snr, decoded);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  frameLength = ax25BuildUi(frame, BEACON_DEST, "N0CALL-7", BEACON_PATH, TEST_INFO);
+  UNITY_BEGIN();
+  RUN_TEST(test_tnc2_format);
+  RUN_TEST(test_clean);
+  RUN_TEST(test_snr);
+  RUN_TEST(test_deemphasis);
+  RUN_TEST(test_clock_offset);
+  RUN_TEST(test_noise_and_speech_only);
+  RUN_TEST(test_snr_sweep);
+  return UNITY_END();
+}
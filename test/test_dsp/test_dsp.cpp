@@ -0,0 +1,241 @@
+// Host checks and timings for the shared DSP kernels: each one against the
+// float code it replaced. Run with `pio test -e native -f test_dsp`.
+
+#include <unity.h>
+#include "config.h"
+#include "dsp.h"
+#include "dtmf.h"
+#include "test_signal.h"
+
+#define TEST_BLOCK 256
+#define BLOCK_LEVEL_MIN_SPEEDUP 1.5  // Over the float meter; ~2.7x vectorized
+
+void setUp() {}
+void tearDown() {}
+
+// ==================== Block Statistics ====================
+
+// The per-sample metering loop recordAudioSamples() used to run. Kept out
+// of line so the timing loop can't fold it away, as blockLevel() is.
+static void __attribute__((noinline)) legacyMeter(const int16_t* samples, int count, float& peakLevel, int& clips) {
+  for (int i = 0; i < count; i++) {
+    int16_t sample = samples[i];
+    float level = abs(sample) / 32768.0;
+    if (level > peakLevel) peakLevel = level;
+    if (abs(sample) > CLIP_THRESHOLD) clips++;
+  }
+}
+
+static void test_block_level_matches_float_meter() {
+  static int16_t block[TEST_BLOCK];
+  for (int offset = 0; offset + TEST_BLOCK <= RADIO_TEST_SAMPLES; offset += TEST_BLOCK) {
+    loadTestAudio(block, TEST_BLOCK, offset);
+    float peakLevel = 0;
+    int clips = 0;
+    legacyMeter(block, TEST_BLOCK, peakLevel, clips);
+
+    double sum = 0, sumSquares = 0;
+    for (int i = 0; i < TEST_BLOCK; i++) {
+      sum += block[i];
+      sumSquares += (double)block[i] * block[i];
+    }
+    double mean = sum / TEST_BLOCK;
+    double rms = sqrt(max(sumSquares / TEST_BLOCK - mean * mean, 0.0));
+
+    BlockLevel level;
+    blockLevel(block, TEST_BLOCK, level);
+    TEST_ASSERT_EQUAL_INT(min(lroundf(peakLevel * 32768), 32767L), level.peak);
+    TEST_ASSERT_EQUAL_INT(clips, level.clips);
+    TEST_ASSERT_FLOAT_WITHIN(1.0, mean, level.dc);
+    TEST_ASSERT_FLOAT_WITHIN(1.0, rms, level.rms);
+  }
+}
+
+static void test_block_level_full_scale() {
+  static int16_t block[TEST_BLOCK];
+  for (int i = 0; i < TEST_BLOCK; i++) block[i] = (i & 1) ? 32767 : -32768;
+
+  BlockLevel level;
+  blockLevel(block, TEST_BLOCK, level);
+  TEST_ASSERT_EQUAL_INT(32767, level.peak);  // -32768 saturates
+  TEST_ASSERT_EQUAL_INT(TEST_BLOCK, level.clips);
+  TEST_ASSERT_EQUAL_INT(0, level.dc);
+  TEST_ASSERT_EQUAL_INT(32767, level.rms);
+
+  blockLevel(block, 0, level);
+  TEST_ASSERT_EQUAL_INT(0, level.peak);
+  TEST_ASSERT_EQUAL_INT(0, level.clips);
+}
+
+static void test_block_level_speed() {
+  static int16_t block[TEST_BLOCK];
+  loadTestAudio(block, TEST_BLOCK, RADIO_TEST_SAMPLES / 2);
+
+  // Best of several runs each, so a preempted run doesn't decide the ratio
+  float peakLevel = 0;
+  int clips = 0;
+  BlockLevel level;
+  uint32_t peakSum = 0;
+  int64_t legacyNs = INT64_MAX, kernelNs = INT64_MAX;
+  for (int run = 0; run < TEST_BENCH_RUNS; run++) {
+    int64_t start = benchNowNs();
+    for (int i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+      legacyMeter(block, TEST_BLOCK, peakLevel, clips);
+    }
+    legacyNs = min(legacyNs, benchNowNs() - start);
+
+    start = benchNowNs();
+    for (int i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+      blockLevel(block, TEST_BLOCK, level);
+      peakSum += level.peak;  // Keep the optimizer honest
+    }
+    kernelNs = min(kernelNs, benchNowNs() - start);
+  }
+
+  printBenchResult("float per-sample meter", legacyNs, TEST_BENCH_ITERATIONS, TEST_BLOCK);
+  printBenchResult("integer blockLevel()", kernelNs, TEST_BENCH_ITERATIONS, TEST_BLOCK);
+  TEST_ASSERT_EQUAL_INT(TEST_BENCH_RUNS * TEST_BENCH_ITERATIONS * level.peak, peakSum);
+  TEST_ASSERT_EQUAL_INT(lroundf(peakLevel * 32768), level.peak);
+  TEST_ASSERT_EQUAL_INT(TEST_BENCH_RUNS * TEST_BENCH_ITERATIONS * level.clips, clips);
+  TEST_ASSERT_TRUE_MESSAGE(kernelNs * BLOCK_LEVEL_MIN_SPEEDUP <= legacyNs, "blockLevel() lost its lead on the float meter");
+}
+
+// ==================== Voice Activity ====================
+
+// Runs a signal through the VAD a capture block at a time, as
+// recordSamples() does. Voiced stretches are two low tones (energy well
+// below 2kHz), carrier is faint noise, the squelch tail is loud hiss.
+enum VadPart { VAD_CARRIER, VAD_VOICE, VAD_HISS };
+
+static void runVad(VadState& vad, const VadPart* parts, int partCount, int partSamples) {
+  static int16_t block[TEST_BLOCK];
+  uint32_t seed = 12345;
+  vadReset(vad);
+  int total = partCount * partSamples;
+  for (int offset = 0; offset < total; offset += TEST_BLOCK) {
+    int count = min(TEST_BLOCK, total - offset);
+    for (int i = 0; i < count; i++) {
+      int n = offset + i;
+      float x;
+      switch (parts[n / partSamples]) {
+        case VAD_VOICE: x = 5000 * sinf(2 * PI * 200 * n / SAMPLE_RATE) + 3000 * sinf(2 * PI * 450 * n / SAMPLE_RATE); break;
+        case VAD_HISS: x = 4000 * testNoise(seed); break;
+        default: x = 40 * testNoise(seed); break;
+      }
+      block[i] = clip16((int32_t)x);
+    }
+    BlockLevel level;
+    blockLevel(block, count, level);
+    vadProcess(vad, block, count, offset, level);
+  }
+}
+
+static void test_vad_trims_carrier_and_tail() {
+  const VadPart parts[] = {VAD_CARRIER, VAD_CARRIER, VAD_VOICE, VAD_VOICE, VAD_HISS, VAD_CARRIER};
+  int partSamples = SAMPLE_RATE / 2;
+  VadState vad;
+  runVad(vad, parts, 6, partSamples);
+  int start, end;
+  TEST_ASSERT_TRUE(vadTrimPoints(vad, 6 * partSamples, start, end));
+  TEST_ASSERT_LESS_OR_EQUAL_INT(TEST_BLOCK, abs(vad.speechStart - 2 * partSamples));
+  TEST_ASSERT_LESS_OR_EQUAL_INT(TEST_BLOCK, abs(vad.speechEnd - 4 * partSamples));
+  TEST_ASSERT_EQUAL_INT(vad.speechStart - VAD_LEAD_MARGIN, start);
+  TEST_ASSERT_EQUAL_INT(vad.speechEnd + VAD_TAIL_MARGIN, end);
+}
+
+// No pre-roll: speech from the very first block, quieter stretches later
+static void test_vad_speech_from_first_block() {
+  const VadPart parts[] = {VAD_VOICE, VAD_CARRIER, VAD_VOICE, VAD_CARRIER};
+  int partSamples = SAMPLE_RATE / 2;
+  VadState vad;
+  runVad(vad, parts, 4, partSamples);
+  TEST_ASSERT_EQUAL_INT(0, vad.speechStart);
+  TEST_ASSERT_LESS_OR_EQUAL_INT(TEST_BLOCK, abs(vad.speechEnd - 3 * partSamples));
+}
+
+// ==================== Goertzel Bank ====================
+
+// The eight float passes detectDTMF() used to make
+static float __attribute__((noinline)) legacyGoertzel(const int16_t* samples, int count, float coeff) {
+  float s0 = 0, s1 = 0, s2 = 0;
+  for (int i = 0; i < count; i++) {
+    s0 = samples[i] + coeff * s1 - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+// A '5' (770 + 1336Hz) over the test audio, so every filter has work to do
+static void loadGoertzelBlock(int16_t* block, int offset) {
+  loadTestAudio(block, DTMF_BLOCK_SIZE, offset);
+  for (int i = 0; i < DTMF_BLOCK_SIZE; i++) {
+    block[i] = block[i] / 2 + (int16_t)(6000 * (sinf(2 * PI * 770 * i / SAMPLE_RATE) + sinf(2 * PI * 1336 * i / SAMPLE_RATE)));
+  }
+}
+
+static void legacyGoertzelBank(const int16_t* block, float* power) {
+  for (int t = 0; t < 8; t++) {
+    float coeff = 2.0f * cosf(2.0f * PI * DtmfTones<SAMPLE_RATE>::hz(t) / SAMPLE_RATE);
+    power[t] = legacyGoertzel(block, DTMF_BLOCK_SIZE, coeff);
+  }
+}
+
+static void test_goertzel_bank_matches_float() {
+  static int16_t block[DTMF_BLOCK_SIZE];
+  for (int offset = 0; offset + DTMF_BLOCK_SIZE <= RADIO_TEST_SAMPLES; offset += 7 * DTMF_BLOCK_SIZE) {
+    loadGoertzelBlock(block, offset);
+    float legacy[8];
+    int64_t power[8];
+    legacyGoertzelBank(block, legacy);
+    DtmfTones<SAMPLE_RATE>::process(block, DTMF_BLOCK_SIZE, power);
+    for (int t = 0; t < 8; t++) {
+      // Relative to the strongest tone: float rounding swamps the weak ones
+      TEST_ASSERT_FLOAT_WITHIN(1e-4 * legacy[5], legacy[t], (float)power[t]);
+    }
+  }
+}
+
+static void test_goertzel_bank_speed() {
+  static int16_t block[DTMF_BLOCK_SIZE];
+  loadGoertzelBlock(block, RADIO_TEST_SAMPLES / 3);
+
+  float legacy[8];
+  int64_t start = benchNowNs();
+  for (int i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+    legacyGoertzelBank(block, legacy);
+  }
+  int64_t legacyNs = benchNowNs() - start;
+
+  int64_t power[8];
+  start = benchNowNs();
+  for (int i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+    DtmfTones<SAMPLE_RATE>::process(block, DTMF_BLOCK_SIZE, power);
+  }
+  int64_t bankNs = benchNowNs() - start;
+
+  float worst = 0;
+  for (int t = 0; t < 8; t++) {
+    float err = fabsf((float)power[t] - legacy[t]) / max(legacy[t], 1.0f);
+    if (err > worst) worst = err;
+  }
+
+  char line[96];
+  printBenchResult("8 float passes", legacyNs, TEST_BENCH_ITERATIONS, DTMF_BLOCK_SIZE);
+  printBenchResult("ToneBank<> Q30", bankNs, TEST_BENCH_ITERATIONS, DTMF_BLOCK_SIZE);
+  snprintf(line, sizeof(line), "worst power difference %.4f%%", 100.0f * worst);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(worst < 1e-3f);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_block_level_matches_float_meter);
+  RUN_TEST(test_block_level_full_scale);
+  RUN_TEST(test_block_level_speed);
+  RUN_TEST(test_vad_trims_carrier_and_tail);
+  RUN_TEST(test_vad_speech_from_first_block);
+  RUN_TEST(test_goertzel_bank_matches_float);
+  RUN_TEST(test_goertzel_bank_speed);
+  return UNITY_END();
+}
@@ -0,0 +1,235 @@
+// Host checks for the streaming DTMF decoder on synthetic digit trains and
+// the embedded test recording, on both the full-rate and the decimated
+// path. Run with `pio test -e native -f test_dtmf`.
+
+#include <unity.h>
+#include "config.h"
+#include "dtmf.h"
+#include "test_signal.h"
+
+#define TEST_BLOCK 256
+#define TEST_TONE_LEVEL 6000   // Row tone amplitude (-15dBFS)
+#define TEST_LEAD_MS 100       // Quiet (or speech) before the first digit
+#define TEST_MIN_DETECT_PCT 95 // Corpus accept cases: digits decoded
+#define TEST_MIN_MSAMPLES 20.0 // Corpus throughput floor per path, host Msamples/s
+
+static const char TEST_DIGITS[] = "123A456B789C*0#D";
+
+void setUp() {}
+void tearDown() {}
+
+struct DtmfCase {
+  const char* name;
+  bool accept;       // Digits must be decoded (else must not be)
+  float snrDb;       // Tone pair over white noise; 99 = no noise
+  float twistDb;     // Column tone below the row tone (negative: above)
+  int toneMs;
+  int gapMs;
+  float offsetPct;   // Both tones off frequency by this much
+  int speechGain;    // Test audio mixed in at this gain; 0 = none
+  bool digits;       // false = speech only (talk-off)
+};
+
+static int caseLength(const DtmfCase& c) {
+  if (!c.digits) return RADIO_TEST_SAMPLES;
+  return SAMPLE_RATE * (TEST_LEAD_MS + 16 * (c.toneMs + c.gapMs)) / 1000;
+}
+
+// Which digit (0-15) sounds at sample n, or -1
+static int caseDigitAt(const DtmfCase& c, int n, int& onset) {
+  if (!c.digits) return -1;
+  int lead = SAMPLE_RATE * TEST_LEAD_MS / 1000;
+  int period = SAMPLE_RATE * (c.toneMs + c.gapMs) / 1000;
+  int tone = SAMPLE_RATE * c.toneMs / 1000;
+  if (n < lead) return -1;
+  int digit = (n - lead) / period;
+  onset = lead + digit * period;
+  return digit < 16 && n - onset < tone ? digit : -1;
+}
+
+static void loadCase(const DtmfCase& c, int16_t* dest, int count, int offset, uint32_t& seed) {
+  float rowLevel = TEST_TONE_LEVEL;
+  float colLevel = TEST_TONE_LEVEL / dbToGain(c.twistDb);
+  // White noise with the tone pair's power / SNR
+  float noiseRms = c.snrDb < 99 ? sqrtf((rowLevel * rowLevel + colLevel * colLevel) / 2.0f) / dbToGain(c.snrDb) : 0;
+  float scale = 1.0f + c.offsetPct / 100.0f;
+  for (int i = 0; i < count; i++) {
+    int n = offset + i;
+    float x = 0;
+    if (c.speechGain) {
+      x += (float)(int16_t)pgm_read_word(&radioTestAudio[n % RADIO_TEST_SAMPLES]) * c.speechGain;
+    }
+    int onset;
+    int digit = caseDigitAt(c, n, onset);
+    if (digit >= 0) {
+      x += rowLevel * sinf(2 * PI * DtmfTones<SAMPLE_RATE>::hz(digit / 4) * scale * n / SAMPLE_RATE);
+      x += colLevel * sinf(2 * PI * DtmfTones<SAMPLE_RATE>::hz(4 + digit % 4) * scale * n / SAMPLE_RATE);
+    }
+    if (noiseRms > 0) x += noiseRms * testNoise(seed);
+    dest[i] = clip16((int32_t)x);
+  }
+}
+
+// Every digit the detector reports, in order; returns how many. The time
+// spent in the detector (not making the signal) is added to detectorNs.
+static int decodeCase(const DtmfCase& c, bool lowRate, DtmfDigit* decoded, int maxDigits, int64_t* detectorNs = nullptr) {
+  static DtmfDetector det;
+  static int16_t block[TEST_BLOCK];
+  dtmfInit(det, lowRate ? DTMF_LOW_RATE_BLOCK_SIZE : DTMF_BLOCK_SIZE, lowRate);
+  uint32_t seed = 12345;
+  int length = 0;
+  int total = caseLength(c);
+  for (int offset = 0; offset < total; offset += TEST_BLOCK) {
+    int count = min(TEST_BLOCK, total - offset);
+    loadCase(c, block, count, offset, seed);
+    int64_t start = benchNowNs();
+    length += dtmfProcess(det, block, count, decoded + length, maxDigits - length);
+    if (detectorNs) *detectorNs += benchNowNs() - start;
+  }
+  return length;
+}
+
+static void assertDecodes(const DtmfCase& c, const char* expected) {
+  DtmfDigit digits[32];
+  char decoded[33];
+  for (int lowRate = 0; lowRate < 2; lowRate++) {
+    int found = decodeCase(c, lowRate, digits, 32);
+    for (int i = 0; i < found; i++) decoded[i] = digits[i].digit;
+    decoded[found] = 0;
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, decoded, lowRate ? "7350Hz path" : "22050Hz path");
+  }
+}
+
+// ==================== Acceptance ====================
+
+static void test_all_digits_50_50ms() {
+  assertDecodes({"", true, 99, 0, 50, 50, 0, 0, true}, TEST_DIGITS);
+}
+
+static void test_all_digits_40_40ms() {
+  assertDecodes({"", true, 99, 0, 40, 40, 0, 0, true}, TEST_DIGITS);
+}
+
+static void test_all_digits_in_noise() {
+  assertDecodes({"", true, 15, 0, 50, 50, 0, 0, true}, TEST_DIGITS);
+  assertDecodes({"", true, 15, 0, 40, 40, 0, 0, true}, TEST_DIGITS);
+}
+
+static void test_all_digits_with_7db_twist() {
+  assertDecodes({"", true, 99, 7, 50, 50, 0, 0, true}, TEST_DIGITS);
+  assertDecodes({"", true, 99, 7, 40, 40, 0, 0, true}, TEST_DIGITS);
+}
+
+// ==================== Rejection ====================
+
+static void test_rejects_5db_reverse_twist() {
+  assertDecodes({"", false, 99, -5, 50, 50, 0, 0, true}, "");
+}
+
+static void test_recording_raises_no_digits() {
+  for (int gain = 1; gain <= 8; gain *= 2) {
+    assertDecodes({"", false, 99, 0, 0, 0, 0, gain, false}, "");
+  }
+}
+
+// ==================== Corpus ====================
+// Digits under the conditions the detector has to cope with on air, plus
+// speech on its own for talk-off. Each case says whether its digits must be
+// decoded (ITU Q.24-style limits) or must not be, and the test fails if any
+// case misses its target on either path. Latency runs from tone onset to
+// the input sample where the detector confirmed the digit.
+
+// Two 12.8ms blocks can't tell a 20ms tone split across them from a 26ms
+// one, so the short-tone case sits below that grey zone.
+static const DtmfCase CORPUS[] = {
+  {"clean 50/50ms",          true,  99,  0, 50, 50,  0,   0, true},
+  {"SNR 20dB",               true,  20,  0, 50, 50,  0,   0, true},
+  {"SNR 12dB",               true,  12,  0, 50, 50,  0,   0, true},
+  {"twist +6dB",             true,  99,  6, 50, 50,  0,   0, true},
+  {"reverse twist 3dB",      true,  99, -3, 50, 50,  0,   0, true},
+  {"twist +12dB",            false, 99, 12, 50, 50,  0,   0, true},
+  {"reverse twist 8dB",      false, 99, -8, 50, 50,  0,   0, true},
+  {"40ms tones, 40ms gaps",  true,  99,  0, 40, 40,  0,   0, true},
+  {"14ms tones",             false, 99,  0, 14, 60,  0,   0, true},
+  {"+1.5% off frequency",    true,  99,  0, 50, 50, 1.5f, 0, true},
+  {"-1.5% off frequency",    true,  99,  0, 50, 50, -1.5f, 0, true},
+  {"over speech",            true,  99,  0, 50, 50,  0,   1, true},
+  {"talk-off x1",            false, 99,  0, 50, 50,  0,   1, false},
+  {"talk-off x2",            false, 99,  0, 50, 50,  0,   2, false},
+  {"talk-off x4",            false, 99,  0, 50, 50,  0,   4, false},
+};
+#define CORPUS_CASES (int)(sizeof(CORPUS) / sizeof(CORPUS[0]))
+
+// Runs one case on one path, prints its row and returns true if it met the
+// target. Adds the samples run and the detector's time to the path's totals.
+static bool runCorpusCase(const DtmfCase& c, bool lowRate, int64_t& samples, int64_t& detectorNs) {
+  DtmfDigit digits[64];
+  int64_t caseNs = 0;
+  int found = decodeCase(c, lowRate, digits, 64, &caseNs);
+  samples += caseLength(c);
+  detectorNs += caseNs;
+  int blockSamples = (lowRate ? DTMF_LOW_RATE_BLOCK_SIZE * DTMF_DECIMATION : DTMF_BLOCK_SIZE);
+  int tone = SAMPLE_RATE * c.toneMs / 1000;
+
+  bool seen[16] = {};
+  int detected = 0, falseDigits = 0;
+  uint32_t latencySum = 0, latencyMax = 0;
+  for (int i = 0; i < found; i++) {
+    // Credit a digit to the tone sounding where it started (the detector
+    // reports the start of its first block, up to a block early)
+    int onset;
+    int digit = caseDigitAt(c, digits[i].onsetSample + blockSamples, onset);
+    if (digit < 0) digit = caseDigitAt(c, digits[i].onsetSample + tone / 2, onset);
+    if (digit >= 0 && !seen[digit] && digits[i].digit == TEST_DIGITS[digit]) {
+      seen[digit] = true;
+      detected++;
+      uint32_t latency = digits[i].detectSample - onset;
+      latencySum += latency;
+      latencyMax = max(latencyMax, latency);
+    } else {
+      falseDigits++;
+    }
+  }
+
+  int expected = c.digits ? 16 : 0;
+  bool pass = c.accept ? detected * 100 >= expected * TEST_MIN_DETECT_PCT && falseDigits == 0
+                       : detected == 0 && falseDigits == 0;
+  char line[160];
+  snprintf(line, sizeof(line), "%-22s %-5s %2d/%-2d decoded %2d false  latency %4.1f/%4.1f ms  %6.1f Msamples/s  %s",
+           lowRate ? "" : c.name, lowRate ? "7k" : "22k", detected, expected, falseDigits,
+           detected ? 1000.0f * latencySum / detected / SAMPLE_RATE : 0.0f,
+           1000.0f * latencyMax / SAMPLE_RATE, 1000.0 * caseLength(c) / max(caseNs, (int64_t)1), pass ? "PASS" : "FAIL");
+  TEST_MESSAGE(line);
+  return pass;
+}
+
+static void test_corpus() {
+  TEST_MESSAGE("16 digits per case, latency mean/max from tone onset to detection");
+  int failures = 0;
+  int64_t fullSamples = 0, fullNs = 0, lowSamples = 0, lowNs = 0;
+  for (int i = 0; i < CORPUS_CASES; i++) {
+    if (!runCorpusCase(CORPUS[i], false, fullSamples, fullNs)) failures++;
+    if (!runCorpusCase(CORPUS[i], true, lowSamples, lowNs)) failures++;
+  }
+
+  char line[96];
+  double fullRate = 1000.0 * fullSamples / max(fullNs, (int64_t)1);
+  double lowRate = 1000.0 * lowSamples / max(lowNs, (int64_t)1);
+  snprintf(line, sizeof(line), "22050Hz path: %6.1f Msamples/s, 7350Hz path: %6.1f Msamples/s", fullRate, lowRate);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_INT(0, failures);
+  TEST_ASSERT_TRUE_MESSAGE(fullRate >= TEST_MIN_MSAMPLES, "22050Hz path below its throughput floor");
+  TEST_ASSERT_TRUE_MESSAGE(lowRate >= TEST_MIN_MSAMPLES, "7350Hz path below its throughput floor");
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_all_digits_50_50ms);
+  RUN_TEST(test_all_digits_40_40ms);
+  RUN_TEST(test_all_digits_in_noise);
+  RUN_TEST(test_all_digits_with_7db_twist);
+  RUN_TEST(test_rejects_5db_reverse_twist);
+  RUN_TEST(test_recording_raises_no_digits);
+  RUN_TEST(test_corpus);
+  return UNITY_END();
+}
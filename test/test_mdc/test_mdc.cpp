@@ -0,0 +1,133 @@
+// Host loopback for the MDC1200 decoder: PTT ID bursts from mdcEncode(),
+// NRZI-keyed onto 1200/1800Hz at -15dBFS, 0.1s into half a second of
+// noise and/or the test audio. Run with `pio test -e native -f test_mdc`.
+
+#include <unity.h>
+#include "config.h"
+#include "mdc.h"
+#include "test_signal.h"
+
+#define TEST_BLOCK 256
+#define TEST_LEVEL 6000
+#define TEST_LEAD (SAMPLE_RATE / 10)
+#define TEST_SAMPLES (SAMPLE_RATE / 2)
+
+void setUp() {}
+void tearDown() {}
+
+struct MdcCase {
+  uint16_t unit;
+  bool burst;        // false = noise/speech only, nothing may decode
+  float snrDb;       // Burst over white noise; 99 = no noise
+  int speechGain;    // Test audio mixed in at this gain; 0 = none
+  float clockPct;    // Sender's bit rate and tones off by this much
+  int errors;        // Coded bits flipped
+};
+
+static void loadMdc(const MdcCase& c, int16_t* dest, int count, int offset, const uint8_t* bits, int bitCount,
+                    uint32_t& seed, uint32_t& phase) {
+  float scale = 1.0f + c.clockPct / 100.0f;
+  float noiseRms = c.snrDb < 99 ? TEST_LEVEL / 1.414f / dbToGain(c.snrDb) : 0;
+  for (int i = 0; i < count; i++) {
+    int n = offset + i;
+    float x = 0;
+    if (c.speechGain) {
+      x += (float)(int16_t)pgm_read_word(&radioTestAudio[n % RADIO_TEST_SAMPLES]) * c.speechGain;
+    }
+    int bit = (int)((n - TEST_LEAD) * MDC_BAUD * scale / SAMPLE_RATE);
+    if (c.burst && n >= TEST_LEAD && bit < bitCount) {
+      // NRZI: the high tone when the bit differs from the one before
+      float hz = (bits[bit] != (bit > 0 ? bits[bit - 1] : 0)) ? MDC_TONE_HIGH_HZ : MDC_TONE_LOW_HZ;
+      phase += (uint32_t)(4294967296.0 * hz * scale / SAMPLE_RATE);
+      x += TEST_LEVEL * sinf(2 * PI * (phase / 4294967296.0f));
+    }
+    if (noiseRms > 0) x += noiseRms * testNoise(seed);
+    if (!c.burst && !c.speechGain) x += TEST_LEVEL * testNoise(seed);
+    dest[i] = clip16((int32_t)x);
+  }
+}
+
+// Sends one burst through the decoder; returns the frames it decoded
+static int runMdcCase(const MdcCase& c, MdcFrame& heard, uint32_t seed = 12345) {
+  static MdcDecoder mdc;
+  static int16_t block[TEST_BLOCK];
+  static uint8_t bits[MDC_BURST_BITS];
+  mdcInit(mdc, SAMPLE_RATE);
+
+  MdcFrame frame = {0x01, 0x80, c.unit};  // PTT ID, post
+  int bitCount = mdcEncode(frame, bits);
+  for (int e = 0; e < c.errors; e++) {
+    int n = MDC_BURST_BITS - MDC_FRAME_BITS + (e * 37 + 5) % MDC_FRAME_BITS;
+    bits[n] ^= 1;
+  }
+
+  uint32_t phase = 0;
+  for (int offset = 0; offset < TEST_SAMPLES; offset += TEST_BLOCK) {
+    loadMdc(c, block, TEST_BLOCK, offset, bits, bitCount, seed, phase);
+    mdcProcess(mdc, block, TEST_BLOCK);
+  }
+  heard = mdc.last;
+  return mdc.frames;
+}
+
+static void assertDecodes(const MdcCase& c) {
+  MdcFrame heard;
+  TEST_ASSERT_TRUE(runMdcCase(c, heard) > 0);
+  TEST_ASSERT_EQUAL_HEX16(c.unit, heard.unit);
+  TEST_ASSERT_EQUAL_HEX8(0x01, heard.op);
+  TEST_ASSERT_EQUAL_HEX8(0x80, heard.arg);
+}
+
+static void test_clean() {
+  assertDecodes({0x1234, true, 99, 0, 0, 0});
+}
+
+static void test_snr_10db() {
+  assertDecodes({0x1234, true, 10, 0, 0, 0});
+  assertDecodes({0x0B7F, true, 10, 0, 0, 0});
+}
+
+static void test_over_speech() {
+  assertDecodes({0x4242, true, 99, 1, 0, 0});
+}
+
+static void test_clock_offset() {
+  assertDecodes({0x0001, true, 20, 0, 2.0f, 0});
+  assertDecodes({0xFFFE, true, 20, 0, -2.0f, 0});
+}
+
+static void test_bit_errors() {
+  assertDecodes({0xBEEF, true, 99, 0, 0, 3});
+}
+
+static void test_noise_and_speech_only() {
+  MdcFrame heard;
+  TEST_ASSERT_EQUAL_INT(0, runMdcCase({0, false, 99, 0, 0, 0}, heard));
+  TEST_ASSERT_EQUAL_INT(0, runMdcCase({0, false, 99, 1, 0, 0}, heard));
+}
+
+// Not a pass/fail limit: how far below 10dB it still holds on, for the log
+static void test_snr_sweep() {
+  char line[64];
+  for (int snr = 10; snr >= 0; snr -= 2) {
+    int decoded = 0;
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+      MdcFrame heard;
+      if (runMdcCase({0x1234, true, (float)snr, 0, 0, 0}, heard, seed) > 0 && heard.unit == 0x1234) decoded++;
+    }
+    snprintf(line, sizeof(line), "SNR %2d dB: %2d/20 bursts decoded", snr, decoded);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean);
+  RUN_TEST(test_snr_10db);
+  RUN_TEST(test_over_speech);
+  RUN_TEST(test_clock_offset);
+  RUN_TEST(test_bit_errors);
+  RUN_TEST(test_noise_and_speech_only);
+  RUN_TEST(test_snr_sweep);
+  return UNITY_END();
+}